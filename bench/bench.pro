@@ -0,0 +1,16 @@
+TEMPLATE = app
+
+CONFIG += qtestlib release warn_on
+
+TARGET = inquest-bench
+
+MOC_DIR = build
+OBJECTS_DIR = build
+
+INCLUDEPATH += ../src
+
+SOURCES += $$files(*.cpp) $$files(../src/*.cpp)
+SOURCES -= ../src/main.cpp
+HEADERS += $$files(*.h) $$files(../src/*.h)
+
+LIBS += -lz
@@ -0,0 +1,71 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchdeck.h"
+#include <QDir>
+#include <QFile>
+#include "random.h"
+
+QStringList BenchDeck::_files;
+
+QString BenchDeck::path(int rows, int columns, int duplicates)
+{
+	QString name = QString("%1/inquest-bench-%2-%3-%4.tsv")
+		.arg(QDir::tempPath()).arg(rows).arg(columns).arg(duplicates);
+	if (_files.contains(name))
+		return name;
+
+	QFile file(name);
+	if (!file.open(QFile::WriteOnly))
+		return QString();
+
+	Random random(rows);
+	int distinct = qMax(1, rows - rows / 100 * duplicates);
+	QByteArray block;
+
+	for (int i = 0; i != rows; ++i) {
+		for (int j = 0; j != columns; ++j) {
+			int word = i < distinct ? i : random.uniform(distinct);
+			if (j)
+				block += '\t';
+			block += 'w';
+			block += QByteArray::number(j);
+			block += '-';
+			block += QByteArray::number(word);
+		}
+		block += '\n';
+
+		if (block.size() >= 1 << 20) {
+			file.write(block);
+			block.resize(0);
+		}
+	}
+
+	if (file.write(block) != block.size())
+		return QString();
+
+	_files.append(name);
+	return name;
+}
+
+void BenchDeck::removeAll()
+{
+	foreach (const QString &file, _files)
+		QFile::remove(file);
+	_files.clear();
+}
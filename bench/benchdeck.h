@@ -0,0 +1,39 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHDECK_H
+#define BENCHDECK_H
+
+#include <QStringList>
+
+/*
+ * Decks whose words are numbers, written to the temporary directory the
+ * first time they are asked for. With duplicates, that share of the words
+ * in each column is drawn again from the rest, so tiles share their text.
+ */
+class BenchDeck {
+public:
+	/* The file name, or an empty string if it could not be written */
+	static QString path(int rows, int columns, int duplicates);
+	static void removeAll();
+
+private:
+	static QStringList _files;
+};
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchdeck.h"
+#include <QApplication>
+#include <QDir>
+#include <QtTest>
+#include "renderbench.h"
+#include "roundbench.h"
+
+/*
+ * The benchmarks are a QTest program of their own, built by bench.pro
+ * from the application's sources. The usual QTest options apply, and are
+ * passed to each set of benchmarks in turn.
+ */
+int main(int argc, char **argv)
+{
+	/* The scene keeps its session under the home directory, which must
+	 * not be the user's */
+	QString home = QDir::temp().filePath("inquest-bench-home");
+	QDir().mkpath(home);
+	qputenv("HOME", QFile::encodeName(home));
+
+	QApplication app(argc, argv);
+	RoundBench round;
+	RenderBench render;
+	int result = QTest::qExec(&round, argc, argv);
+	result |= QTest::qExec(&render, argc, argv);
+
+	BenchDeck::removeAll();
+	return result;
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchdeck.h"
+#include "col.h"
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QGraphicsSceneMouseEvent>
+#include <QImage>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QtTest>
+#include "renderbench.h"
+#include "tile.h"
+#include "tilescene.h"
+#include "tileview.h"
+
+/* Frames painted for each result */
+static const int Frames = 100;
+
+/* With highlights, each round again with every tile shown correct */
+void RenderBench::addRounds(bool highlights)
+{
+	static const int Rounds[] = { 16, 256, 1024 };
+	static const qreal Zooms[] = { 0.5, 1, 2 };
+	static const char *Modes[] = { "items", "batched", "virtualized" };
+
+	QTest::addColumn<int>("rows");
+	QTest::addColumn<qreal>("zoom");
+	QTest::addColumn<QString>("mode");
+	QTest::addColumn<bool>("highlighted");
+
+	for (int r = 0; r != 3; ++r)
+		for (int z = 0; z != 3; ++z)
+			for (int m = 0; m != 3; ++m)
+				for (int h = 0; h != (highlights ? 2 : 1); ++h)
+					QTest::newRow(qPrintable(QString("%1 rows, zoom %2, %3%4")
+						.arg(Rounds[r]).arg(Zooms[z]).arg(Modes[m])
+						.arg(h ? ", highlighted" : "")))
+						<< Rounds[r] << Zooms[z] << QString(Modes[m]) << bool(h);
+}
+
+bool RenderBench::start(TileScene *scene, TileView *view)
+{
+	QFETCH(int, rows);
+	QFETCH(qreal, zoom);
+	QFETCH(QString, mode);
+
+	QString file = BenchDeck::path(1024, 2, 0);
+	if (file.isEmpty())
+		return false;
+
+	scene->setSeed(rows);
+	scene->setRoundSize(rows);
+	scene->setBatched(mode == "batched");
+	scene->setVirtualized(mode == "virtualized");
+	if (!scene->fill(file, false))
+		return false;
+	scene->skip();
+	QCoreApplication::processEvents();
+
+	view->resize(800, 600);
+	view->setAttribute(Qt::WA_DontShowOnScreen);
+	view->show();
+	view->fit(scene->sceneRect());
+	view->scale(zoom, zoom);
+	scene->setViewRect(view->mapToScene(view->viewport()->rect()).boundingRect());
+	return scene->rowCount() == rows;
+}
+
+void RenderBench::report(QVector<qint64> *frames)
+{
+	qSort(frames->begin(), frames->end());
+	int last = frames->size() - 1;
+
+	qDebug("p90 %.3f ms, p99 %.3f ms, max %.3f ms",
+	       frames->at(last * 90 / 100) / 1e6, frames->at(last * 99 / 100) / 1e6,
+	       frames->at(last) / 1e6);
+	QTest::setBenchmarkResult(frames->at(last / 2) / 1e6, QTest::WalltimeMilliseconds);
+}
+
+void RenderBench::frames_data()
+{
+	addRounds(true);
+}
+
+void RenderBench::frames()
+{
+	QFETCH(bool, highlighted);
+	TileScene scene;
+	TileView view(&scene);
+	QVERIFY(start(&scene, &view));
+
+	for (int i = 0; i != scene.colCount(); ++i)
+		foreach (Tile *tile, *scene.col(i)->tiles())
+			tile->showCorrect(highlighted);
+
+	QImage image(view.viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+	QPainter painter(&image);
+	QElapsedTimer timer;
+	QVector<qint64> frames;
+
+	for (int i = 0; i != Frames; ++i) {
+		timer.start();
+		image.fill(0xffffffff);
+		view.render(&painter);
+		frames.append(timer.nsecsElapsed());
+	}
+
+	painter.end();
+	report(&frames);
+}
+
+void RenderBench::drag_data()
+{
+	addRounds(false);
+}
+
+/* A tile dragged down half the view with the mouse, painting after each
+ * move */
+void RenderBench::drag()
+{
+	TileScene scene;
+	TileView view(&scene);
+	QVERIFY(start(&scene, &view));
+	/* Nothing is left shown correct */
+	scene.reset();
+
+	QRectF shown = view.mapToScene(view.viewport()->rect()).boundingRect();
+	Tile *tile = shownTile(&scene, shown);
+	QVERIFY(tile);
+
+	QImage image(view.viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+	QPainter painter(&image);
+	QElapsedTimer timer;
+	QVector<qint64> frames;
+
+	QPointF from = tile->pos();
+	QPointF down = tile->rect().center();
+	QPointF last = down;
+	qreal step = shown.height() / 2 / Frames;
+
+	sendMouse(&scene, QEvent::GraphicsSceneMousePress, down, down, down);
+	for (int i = 1; i <= Frames; ++i) {
+		QPointF pos = down + QPointF(0, i * step);
+		timer.start();
+		sendMouse(&scene, QEvent::GraphicsSceneMouseMove, pos, last, down);
+		image.fill(0xffffffff);
+		view.render(&painter);
+		frames.append(timer.nsecsElapsed());
+		last = pos;
+	}
+	sendMouse(&scene, QEvent::GraphicsSceneMouseRelease, last, last, down);
+
+	painter.end();
+	QVERIFY(qAbs(tile->y() - (from.y() + Frames * step)) < 0.01);
+	report(&frames);
+}
+
+void RenderBench::lowLatencyDrag_data()
+{
+	addRounds(false);
+}
+
+/* The same drag with low-latency dragging, the mouse events going to the
+ * view; the scene keeps its index all the while */
+void RenderBench::lowLatencyDrag()
+{
+	TileScene scene;
+	TileView view(&scene);
+	QVERIFY(start(&scene, &view));
+	scene.reset();
+	view.setLowLatencyDrag(true);
+
+	QRectF shown = view.mapToScene(view.viewport()->rect()).boundingRect();
+	Tile *tile = shownTile(&scene, shown);
+	QVERIFY(tile);
+
+	QImage image(view.viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+	QPainter painter(&image);
+	QElapsedTimer timer;
+	QVector<qint64> frames;
+
+	QPointF from = tile->pos();
+	QPoint down = view.mapFromScene(tile->rect().center());
+	int step = qMax(1, view.viewport()->height() / 2 / Frames);
+
+	QMouseEvent press(QEvent::MouseButtonPress, down, Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+	QApplication::sendEvent(view.viewport(), &press);
+	QCOMPARE(scene.dragging(), tile);
+	QPoint pos = down;
+	for (int i = 1; i <= Frames; ++i) {
+		pos = down + QPoint(0, i * step);
+		timer.start();
+		QMouseEvent move(QEvent::MouseMove, pos, Qt::NoButton, Qt::LeftButton, Qt::NoModifier);
+		QApplication::sendEvent(view.viewport(), &move);
+		QApplication::processEvents();
+		image.fill(0xffffffff);
+		view.render(&painter);
+		frames.append(timer.nsecsElapsed());
+		QCOMPARE(scene.itemIndexMethod(), QGraphicsScene::BspTreeIndex);
+	}
+	QMouseEvent release(QEvent::MouseButtonRelease, pos, Qt::LeftButton, Qt::NoButton, Qt::NoModifier);
+	QApplication::sendEvent(view.viewport(), &release);
+
+	painter.end();
+	QVERIFY(!scene.dragging());
+	QVERIFY(qAbs(tile->y() - from.y() - (view.mapToScene(pos).y() - view.mapToScene(down).y())) < 0.01);
+	report(&frames);
+}
+
+Tile *RenderBench::shownTile(TileScene *scene, const QRectF &shown)
+{
+	for (int i = 0; i != scene->colCount(); ++i)
+		foreach (Tile *tile, *scene->col(i)->tiles())
+			if (tile->isMovable() && shown.contains(tile->rect()))
+				return tile;
+	return NULL;
+}
+
+/* As a view would send it, with the left button */
+void RenderBench::sendMouse(TileScene *scene, QEvent::Type type, const QPointF &pos, const QPointF &last, const QPointF &down)
+{
+	QGraphicsSceneMouseEvent ev(type);
+	ev.setScenePos(pos);
+	ev.setLastScenePos(last);
+	ev.setButtonDownScenePos(Qt::LeftButton, down);
+	ev.setButton(type == QEvent::GraphicsSceneMouseMove ? Qt::NoButton : Qt::LeftButton);
+	ev.setButtons(type == QEvent::GraphicsSceneMouseRelease ? Qt::NoButton : Qt::LeftButton);
+	ev.setAccepted(false);
+	QApplication::sendEvent(scene, &ev);
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RENDERBENCH_H
+#define RENDERBENCH_H
+
+#include <QEvent>
+#include <QObject>
+#include <QVector>
+
+class QPointF;
+class QRectF;
+class Tile;
+class TileScene;
+class TileView;
+
+/*
+ * Paints a round through a TileView into an image over and over, with 16
+ * to 1024 rows on the board, zoomed out, as fitted and zoomed in, and with
+ * an item for each tile, one item for each column or items only near the
+ * view. The result is the median frame; the 90th and 99th percentile and
+ * the slowest frame are logged.
+ */
+class RenderBench : public QObject {
+	Q_OBJECT
+
+private slots:
+	void frames_data();
+	void frames();
+	void drag_data();
+	void drag();
+	void lowLatencyDrag_data();
+	void lowLatencyDrag();
+
+private:
+	static void addRounds(bool highlights);
+	/* Fills scene, draws a round and shows it in view as the current
+	 * data row asks */
+	static bool start(TileScene *scene, TileView *view);
+	static void report(QVector<qint64> *frames);
+	/* The first movable tile that is all in shown */
+	static Tile *shownTile(TileScene *scene, const QRectF &shown);
+	static void sendMouse(TileScene *scene, QEvent::Type type, const QPointF &pos, const QPointF &last, const QPointF &down);
+};
+
+#endif
@@ -0,0 +1,306 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchdeck.h"
+#include "col.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QtTest>
+#include "roundbench.h"
+#include "tile.h"
+#include "tilescene.h"
+
+/* Rows on the board in each round */
+static const int BoardRows = 256;
+/* Rounds timed by the benchmarks that time by hand */
+static const int Rounds = 3;
+
+void RoundBench::addDecks()
+{
+	static const int Sizes[] = { 1000, 100000, 1000000 };
+	static const int Columns[] = { 2, 4 };
+	static const int Duplicates[] = { 0, 50 };
+
+	QTest::addColumn<int>("rows");
+	QTest::addColumn<int>("columns");
+	QTest::addColumn<int>("duplicates");
+
+	for (int s = 0; s != 3; ++s)
+		for (int c = 0; c != 2; ++c)
+			for (int d = 0; d != 2; ++d)
+				QTest::newRow(qPrintable(QString("%1 rows, %2 columns, %3% duplicates")
+					.arg(Sizes[s]).arg(Columns[c]).arg(Duplicates[d])))
+					<< Sizes[s] << Columns[c] << Duplicates[d];
+}
+
+bool RoundBench::start(TileScene *scene)
+{
+	QFETCH(int, rows);
+	QFETCH(int, columns);
+	QFETCH(int, duplicates);
+
+	QString file = BenchDeck::path(rows, columns, duplicates);
+	if (file.isEmpty())
+		return false;
+
+	scene->setSeed(rows);
+	scene->setRoundSize(qMin(BoardRows, rows));
+	if (!scene->fill(file, false))
+		return false;
+
+	scene->skip();
+	/* Released tiles go back to their pools from the event loop */
+	QCoreApplication::processEvents();
+	return scene->rowCount() == qMin(BoardRows, rows);
+}
+
+int RoundBench::solve(TileScene *scene, Row *except)
+{
+	QHash<Row*, Tile*> first;
+	foreach (Tile *tile, *scene->col(0)->tiles())
+		first.insert(tile->defaultRow(), tile);
+
+	int drops = 0;
+	for (int i = 1; i != scene->colCount(); ++i)
+		foreach (Tile *tile, *scene->col(i)->tiles())
+			if (tile->defaultRow() != except) {
+				tile->setPos(tile->x(), first.value(tile->defaultRow())->y());
+				scene->dropTile(tile);
+				++drops;
+			}
+
+	return drops;
+}
+
+void RoundBench::fill_data()
+{
+	addDecks();
+}
+
+void RoundBench::fill()
+{
+	QFETCH(int, rows);
+	QFETCH(int, columns);
+	QFETCH(int, duplicates);
+
+	QString file = BenchDeck::path(rows, columns, duplicates);
+	QVERIFY(!file.isEmpty());
+
+	TileScene scene;
+	QBENCHMARK {
+		QVERIFY(scene.fill(file, false));
+	}
+}
+
+void RoundBench::firstRound_data()
+{
+	addDecks();
+}
+
+/* The time per tile of a round on a new scene, whose pools are empty, so
+ * every tile, item and row is made */
+void RoundBench::firstRound()
+{
+	QFETCH(int, rows);
+	QFETCH(int, columns);
+	QFETCH(int, duplicates);
+
+	QString file = BenchDeck::path(rows, columns, duplicates);
+	QVERIFY(!file.isEmpty());
+
+	QElapsedTimer timer;
+	qint64 total = 0;
+	int tiles = 0;
+
+	for (int i = 0; i != Rounds; ++i) {
+		TileScene scene;
+		scene.setRoundSize(qMin(BoardRows, rows));
+		QVERIFY(scene.fill(file, false));
+		timer.start();
+		scene.skip();
+		total += timer.nsecsElapsed();
+		tiles += scene.rowCount() * columns;
+	}
+
+	QTest::setBenchmarkResult(total / 1e6 / tiles, QTest::WalltimeMilliseconds);
+}
+
+void RoundBench::round_data()
+{
+	addDecks();
+}
+
+/* The unsolved rows go back to the bank and a new round is drawn */
+void RoundBench::round()
+{
+	TileScene scene;
+	QVERIFY(start(&scene));
+
+	QBENCHMARK {
+		scene.skip();
+		QCoreApplication::processEvents();
+	}
+}
+
+void RoundBench::pools_data()
+{
+	addDecks();
+}
+
+/* Once the pools have grown to the board, rounds allocate nothing, and
+ * shrinking the board gives back what it no longer needs */
+void RoundBench::pools()
+{
+	TileScene scene;
+	QVERIFY(start(&scene));
+	for (int i = 0; i != Rounds; ++i) {
+		scene.skip();
+		QCoreApplication::processEvents();
+	}
+
+	int rows = scene.rowAllocations();
+	int tiles = scene.tileAllocations();
+	int items = scene.itemAllocations();
+	for (int i = 0; i != 4 * Rounds; ++i) {
+		scene.skip();
+		QCoreApplication::processEvents();
+	}
+	QCOMPARE(scene.rowAllocations(), rows);
+	QCOMPARE(scene.tileAllocations(), tiles);
+	QCOMPARE(scene.itemAllocations(), items);
+
+	/* The tiles kept for the rows taken off are deleted, so putting the
+	 * rows back has to make tiles again */
+	int board = scene.rowCount();
+	while (scene.rowCount() > 1)
+		scene.removeOne();
+	QCoreApplication::processEvents();
+	while (scene.rowCount() < board)
+		scene.addOne();
+	QVERIFY(scene.tileAllocations() > tiles);
+}
+
+void RoundBench::layout_data()
+{
+	addDecks();
+}
+
+void RoundBench::layout()
+{
+	TileScene scene;
+	QVERIFY(start(&scene));
+
+	QBENCHMARK {
+		scene.layout();
+	}
+}
+
+void RoundBench::place_data()
+{
+	addDecks();
+}
+
+/* Every tile is put back in its slot */
+void RoundBench::place()
+{
+	TileScene scene;
+	QVERIFY(start(&scene));
+
+	QBENCHMARK {
+		scene.reset();
+	}
+}
+
+void RoundBench::checkRow_data()
+{
+	addDecks();
+}
+
+/* The time of one drop, checked against the rows on the board */
+void RoundBench::checkRow()
+{
+	TileScene scene;
+	QVERIFY(start(&scene));
+
+	QElapsedTimer timer;
+	qint64 total = 0;
+	int drops = 0;
+
+	for (int i = 0; i != Rounds; ++i) {
+		scene.reset();
+		timer.start();
+		drops += solve(&scene);
+		total += timer.nsecsElapsed();
+	}
+
+	QVERIFY(drops);
+	QTest::setBenchmarkResult(total / 1e6 / drops, QTest::WalltimeMilliseconds);
+}
+
+void RoundBench::stripCorrect_data()
+{
+	addDecks();
+}
+
+/* A relayout after all but one row were solved; the solved rows leave the
+ * board, and are not drawn again, so only a few rounds are timed */
+void RoundBench::stripCorrect()
+{
+	QFETCH(int, rows);
+	TileScene scene;
+	QVERIFY(start(&scene));
+
+	QElapsedTimer timer;
+	qint64 total = 0;
+
+	for (int i = 0; i != Rounds; ++i) {
+		if (i) {
+			scene.skip();
+			QCoreApplication::processEvents();
+		}
+		QCOMPARE(scene.rowCount(), qMin(BoardRows, rows));
+
+		solve(&scene, scene.col(0)->tiles()->first()->defaultRow());
+		timer.start();
+		scene.layout();
+		total += timer.nsecsElapsed();
+	}
+
+	QTest::setBenchmarkResult(total / 1e6 / Rounds, QTest::WalltimeMilliseconds);
+}
+
+void RoundBench::dump_data()
+{
+	addDecks();
+}
+
+/* The bank and the board written out, waiting for the thread pool */
+void RoundBench::dump()
+{
+	TileScene scene;
+	QVERIFY(start(&scene));
+
+	QString file = QDir::temp().filePath("inquest-bench.dump.tsv");
+	QBENCHMARK {
+		scene.dump(file);
+		scene.waitForDump();
+	}
+	QCoreApplication::processEvents();
+	QFile::remove(file);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ROUNDBENCH_H
+#define ROUNDBENCH_H
+
+#include <QObject>
+
+class Row;
+class TileScene;
+
+/*
+ * Times the hot paths of a round on generated decks of 1000 to a million
+ * rows, with two or four columns and with no or half of the words
+ * repeated. Each round has up to 256 rows. Only the public interface of
+ * the scene is used, so the paths timed are the ones the window takes.
+ * pools() times nothing; it checks that rounds stop allocating once the
+ * pools have grown, and that the pools shrink with the board.
+ */
+class RoundBench : public QObject {
+	Q_OBJECT
+
+private slots:
+	void fill_data();
+	void fill();
+	void firstRound_data();
+	void firstRound();
+	void round_data();
+	void round();
+	void pools_data();
+	void pools();
+	void layout_data();
+	void layout();
+	void place_data();
+	void place();
+	void checkRow_data();
+	void checkRow();
+	void stripCorrect_data();
+	void stripCorrect();
+	void dump_data();
+	void dump();
+
+private:
+	static void addDecks();
+	/* Fills scene from the deck of the current data row and draws the
+	 * first round */
+	static bool start(TileScene *scene);
+	/* Drops every tile next to its row's tile in the first column, except
+	 * the tiles of except; returns the number of drops */
+	static int solve(TileScene *scene, Row *except = 0);
+};
+
+#endif
@@ -9,3 +9,5 @@ OBJECTS_DIR = build
 
 SOURCES += src/*.cpp
 HEADERS += src/*.h
+
+LIBS += -lz
@@ -0,0 +1,296 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bank.h"
+#include <QIODevice>
+#include "reviews.h"
+
+Bank::Bank()
+	: _weighted(false)
+	, _reviews(NULL)
+{
+}
+
+void Bank::clear()
+{
+	_entries.clear();
+	_decks.clear();
+	_tree.clear();
+	_dues.clear();
+}
+
+int Bank::deckIndex(Deck *deck)
+{
+	for (int i = 0; i != _decks.size(); ++i)
+		if (_decks.at(i).data() == deck)
+			return i;
+
+	_decks.append(DeckRef(deck));
+	return _decks.size() - 1;
+}
+
+void Bank::add(Deck *deck)
+{
+	Ref ref;
+	ref.deck = deckIndex(deck);
+
+	_entries.reserve(_entries.size() + deck->size());
+	for (ref.line = 0; ref.line != deck->size(); ++ref.line) {
+		_entries.append(ref);
+		if (_reviews)
+			_dues.append(due(ref));
+	}
+
+	if (_weighted)
+		rebuildTree();
+	if (_reviews)
+		heapify();
+}
+
+/*
+ * Draws are O(1) in uniform mode and O(log n) in weighted and scheduled
+ * mode: the drawn entry is replaced by the last one, so nothing has to be
+ * shifted.
+ */
+Bank::Entry Bank::take()
+{
+	int last = _entries.size() - 1;
+	int i = -1;
+
+	if (_reviews) {
+		Ref ref = _entries.at(0);
+		swap(0, last);
+		_entries.resize(last);
+		_dues.resize(last);
+		siftDown(0);
+		return Entry(_decks.at(ref.deck), ref.line);
+	}
+
+	if (_weighted) {
+		qreal total = 0;
+		for (int j = last + 1; j; j -= j & -j)
+			total += _tree.at(j - 1);
+		if (total > 0)
+			i = findWeight(total * _random.uniform(1 << 30) / (1 << 30));
+	}
+
+	if (i == -1)
+		i = _random.uniform(last + 1);
+
+	Ref ref = _entries.at(i);
+
+	if (_weighted) {
+		_tree.resize(last);
+		if (i != last)
+			addWeight(i, weight(_entries.at(last)) - weight(ref));
+	}
+
+	_entries[i] = _entries.at(last);
+	_entries.resize(last);
+
+	return Entry(_decks.at(ref.deck), ref.line);
+}
+
+void Bank::put(const Entry &entry)
+{
+	Ref ref;
+	ref.deck = deckIndex(entry.deck.data());
+	ref.line = entry.line;
+	_entries.append(ref);
+
+	if (_weighted)
+		appendWeight(weight(ref));
+	if (_reviews) {
+		_dues.append(due(ref));
+		siftUp(_entries.size() - 1);
+	}
+}
+
+void Bank::remove(QHash<QByteArray, int> *lines)
+{
+	if (lines->isEmpty())
+		return;
+
+	int kept = 0;
+	for (int i = 0; i != _entries.size(); ++i) {
+		Ref ref = _entries.at(i);
+		QHash<QByteArray, int>::iterator count = lines->find(_decks.at(ref.deck)->line(ref.line));
+		if (count != lines->end() && *count) {
+			if (!--*count)
+				lines->erase(count);
+			continue;
+		}
+		if (_reviews)
+			_dues[kept] = _dues.at(i);
+		_entries[kept++] = ref;
+	}
+
+	_entries.resize(kept);
+	if (_weighted)
+		rebuildTree();
+	if (_reviews) {
+		_dues.resize(kept);
+		heapify();
+	}
+}
+
+void Bank::setWeighted(bool weighted)
+{
+	if (weighted)
+		setSchedule(NULL);
+
+	_weighted = weighted;
+	if (weighted)
+		rebuildTree();
+	else
+		_tree.clear();
+}
+
+void Bank::setSchedule(const Reviews *reviews)
+{
+	if (reviews)
+		setWeighted(false);
+
+	_reviews = reviews;
+	_dues.clear();
+	if (reviews) {
+		_dues.reserve(_entries.size());
+		foreach (const Ref &ref, _entries)
+			_dues.append(due(ref));
+		heapify();
+	}
+}
+
+qint64 Bank::due(const Ref &ref) const
+{
+	return _reviews->due(_decks.at(ref.deck)->line(ref.line));
+}
+
+void Bank::swap(int i, int j)
+{
+	qSwap(_entries[i], _entries[j]);
+	qSwap(_dues[i], _dues[j]);
+}
+
+void Bank::heapify()
+{
+	for (int i = _entries.size() / 2 - 1; i >= 0; --i)
+		siftDown(i);
+}
+
+void Bank::siftUp(int i)
+{
+	while (i) {
+		int parent = (i - 1) / 2;
+		if (_dues.at(parent) <= _dues.at(i))
+			break;
+		swap(i, parent);
+		i = parent;
+	}
+}
+
+void Bank::siftDown(int i)
+{
+	int n = _entries.size();
+	for (;;) {
+		int least = i;
+		int left = 2 * i + 1;
+		int right = left + 1;
+		if (left < n && _dues.at(left) < _dues.at(least))
+			least = left;
+		if (right < n && _dues.at(right) < _dues.at(least))
+			least = right;
+		if (least == i)
+			break;
+		swap(i, least);
+		i = least;
+	}
+}
+
+qreal Bank::weight(const Ref &ref) const
+{
+	return 1.0 / _decks.at(ref.deck)->size();
+}
+
+void Bank::rebuildTree()
+{
+	int n = _entries.size();
+	_tree.resize(n);
+
+	for (int i = 0; i != n; ++i)
+		_tree[i] = weight(_entries.at(i));
+
+	/* Node k (stored at k - 1) covers (k - lowbit(k), k] */
+	for (int k = 1; k <= n; ++k) {
+		int parent = k + (k & -k);
+		if (parent <= n)
+			_tree[parent - 1] += _tree.at(k - 1);
+	}
+}
+
+void Bank::addWeight(int i, qreal delta)
+{
+	for (int k = i + 1; k <= _tree.size(); k += k & -k)
+		_tree[k - 1] += delta;
+}
+
+void Bank::appendWeight(qreal weight)
+{
+	int k = _tree.size() + 1;
+	for (int j = k - 1; j > k - (k & -k); j -= j & -j)
+		weight += _tree.at(j - 1);
+	_tree.append(weight);
+}
+
+/* Index of the entry whose weight interval contains target */
+int Bank::findWeight(qreal target) const
+{
+	int n = _tree.size();
+	int pos = 0;
+	int step = 1;
+	while (step * 2 <= n)
+		step *= 2;
+
+	for (; step; step /= 2)
+		if (pos + step <= n && _tree.at(pos + step - 1) <= target) {
+			pos += step;
+			target -= _tree.at(pos - 1);
+		}
+
+	return qMin(pos, n - 1);
+}
+
+/* Lines are gathered into large blocks, so a big bank takes few writes */
+bool Bank::write(QIODevice *out) const
+{
+	const int BlockSize = 1 << 20;
+	QByteArray block;
+	block.reserve(BlockSize + 4096);
+
+	foreach (const Ref &ref, _entries) {
+		block += _decks.at(ref.deck)->line(ref.line);
+		block += '\n';
+		if (block.size() >= BlockSize) {
+			if (out->write(block) != block.size())
+				return false;
+			block.resize(0);
+		}
+	}
+
+	return out->write(block) == block.size();
+}
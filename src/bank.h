@@ -0,0 +1,120 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BANK_H
+#define BANK_H
+
+#include "deck.h"
+#include <QExplicitlySharedDataPointer>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include "random.h"
+
+class QIODevice;
+class Reviews;
+
+/*
+ * The words that have not been drawn yet. Entries are just line numbers into
+ * the decks they came from; the text is only decoded when an entry is drawn.
+ */
+class Bank {
+public:
+	typedef QExplicitlySharedDataPointer<Deck> DeckRef;
+
+	/* An entry that has been taken out of the bank. It keeps its deck alive,
+	 * so it can be put back even after the bank has been refilled. */
+	struct Entry {
+		Entry() : line(-1) { }
+		Entry(const DeckRef &d, int l) : deck(d), line(l) { }
+
+		inline bool isNull() const { return !deck; }
+		inline QStringList fields() const { return deck->fields(line); }
+		inline QByteArray text() const { return deck->line(line); }
+
+		DeckRef deck;
+		int line;
+	};
+
+	Bank();
+
+	inline bool isEmpty() const { return _entries.isEmpty(); }
+	inline int size() const { return _entries.size(); }
+	inline bool isWeighted() const { return _weighted; }
+	inline bool isScheduled() const { return _reviews; }
+	inline int deckCount() const { return _decks.size(); }
+
+	void clear();
+	void add(Deck *deck);
+	Entry take();
+	void put(const Entry &entry);
+	/* Removes one entry for each count of each text in lines, and lowers
+	 * the counts by the number removed. */
+	void remove(QHash<QByteArray, int> *lines);
+	/* Copies of a bank share their entries until one of them changes, so
+	 * a copy can be written out on another thread. */
+	bool write(QIODevice *out) const;
+
+	/* In weighted mode, each deck gets an equal share of the draws however
+	 * many lines it has: an entry is drawn with probability inversely
+	 * proportional to the size of its deck. */
+	void setWeighted(bool weighted);
+
+	/* With reviews, the entry that is due first is drawn, through a heap
+	 * ordered by due time, and weights are not used. Entries keep the due
+	 * time they had when they went in, so a word whose review changes has
+	 * to be taken out and put back. Pass NULL to draw at random again. */
+	void setSchedule(const Reviews *reviews);
+
+	/* Draws are made from the bank's own stream, so they only depend on
+	 * the seed and the order of the entries */
+	inline void setSeed(quint64 seed) { _random.setSeed(seed); }
+
+private:
+	struct Ref {
+		int deck;
+		int line;
+	};
+
+	int deckIndex(Deck *deck);
+	qreal weight(const Ref &ref) const;
+
+	void rebuildTree();
+	void addWeight(int i, qreal delta);
+	void appendWeight(qreal weight);
+	int findWeight(qreal target) const;
+
+	qint64 due(const Ref &ref) const;
+	void heapify();
+	void siftUp(int i);
+	void siftDown(int i);
+	void swap(int i, int j);
+
+	QList<DeckRef> _decks;
+	QVector<Ref> _entries;
+	bool _weighted;
+	/* Fenwick tree over the weights of _entries, in weighted mode */
+	QVector<qreal> _tree;
+	/* In scheduled mode, _entries is a min-heap on these, which line up
+	 * with it */
+	const Reviews *_reviews;
+	QVector<qint64> _dues;
+	Random _random;
+};
+
+#endif
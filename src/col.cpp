@@ -17,62 +17,325 @@
  */
 
 #include "col.h"
+#include "colitem.h"
+#include <qmath.h>
 #include "row.h"
 #include "tile.h"
+#include "tileitem.h"
 #include "tilescene.h"
+#include "trace.h"
 
 Col::Col(TileScene *parent, int group, LayoutMode mode)
 	: QObject(parent)
+	, _item(NULL)
 	, _movable(true)
 	, _visible(true)
 	, _layout(mode)
 	, _group(group)
 	, _height(0)
 	, _width(0)
+	, _tileHeight(0)
+	, _x(0)
+	, _y(0)
+	, _dirty(0)
+	, _tileAllocations(0)
 {
 }
 
-Tile *Col::find(const QString &text)
+Col::~Col()
+{
+	setBatched(false);
+	qDeleteAll(_freeTiles);
+}
+
+TileScene *Col::scene() const
+{
+	return static_cast<TileScene*>(parent());
+}
+
+int Col::band(qreal y)
+{
+	return qFloor(y / BandHeight);
+}
+
+const QList<Tile*> &Col::dups(const QString &text) const
+{
+	static const QList<Tile*> none;
+	QHash<QString, QList<Tile*> >::const_iterator group = _dups.constFind(text);
+	return group == _dups.constEnd() ? none : group.value();
+}
+
+/* The last tile of the group takes the place of the removed one */
+void Col::removeDup(Tile *tile)
+{
+	QHash<QString, QList<Tile*> >::iterator group = _dups.find(tile->text());
+	Tile *last = group->takeLast();
+	if (last != tile) {
+		(*group)[tile->dupIndex()] = last;
+		last->setDupIndex(tile->dupIndex());
+	}
+	if (group->isEmpty())
+		_dups.erase(group);
+	tile->setDupIndex(-1);
+}
+
+void Col::findNear(int y, QVarLengthArray<Tile*, 32> *result) const
+{
+	for (int i = band(y - 10), end = band(y + 5); i <= end; ++i) {
+		QHash<int, QList<Tile*> >::const_iterator tiles = _bands.constFind(i);
+		if (tiles == _bands.constEnd())
+			continue;
+
+		foreach (Tile *tile, *tiles)
+			if (tile->y() > y - 10 && tile->y() < y + 5 && !tile->isShownCorrect())
+				result->append(tile);
+	}
+}
+
+void Col::findIn(const QRectF &rect, QVarLengthArray<Tile*, 256> *result) const
+{
+	for (int i = band(rect.top() - _tileHeight), end = band(rect.bottom()); i <= end; ++i) {
+		QHash<int, QList<Tile*> >::const_iterator tiles = _bands.constFind(i);
+		if (tiles == _bands.constEnd())
+			continue;
+
+		foreach (Tile *tile, *tiles)
+			if (rect.intersects(tile->rect()))
+				result->append(tile);
+	}
+}
+
+void Col::unband(Tile *tile)
+{
+	QHash<int, QList<Tile*> >::iterator from = _bands.find(tile->band());
+	from->removeOne(tile);
+	if (from->isEmpty())
+		_bands.erase(from);
+	tile->setBand(Tile::NoBand);
+}
+
+void Col::liftTile(Tile *tile)
+{
+	if (tile->band() != Tile::NoBand)
+		unband(tile);
+	updateItem(tile);
+	updateTile(tile);
+}
+
+void Col::settleTile(Tile *tile)
+{
+	/* Not if it was taken out of the column while lifted */
+	if (tile->band() != Tile::NoBand || tile->index() == -1)
+		return;
+
+	int to = band(tile->y());
+	_bands[to].append(tile);
+	tile->setBand(to);
+	if (_item)
+		_item->include(tile);
+	updateItem(tile);
+	updateTile(tile);
+}
+
+void Col::moveTile(Tile *tile, const QPointF &from)
+{
+	/* Lifted, or not in the column */
+	if (tile->band() == Tile::NoBand)
+		return;
+
+	int to = band(tile->y());
+	if (to != tile->band()) {
+		QHash<int, QList<Tile*> >::iterator old = _bands.find(tile->band());
+		old->removeOne(tile);
+		if (old->isEmpty())
+			_bands.erase(old);
+
+		_bands[to].append(tile);
+		tile->setBand(to);
+	}
+
+	if (_item) {
+		_item->update(QRectF(from, tile->size()));
+		_item->include(tile);
+		_item->update(tile->rect());
+	} else
+		updateItem(tile);
+}
+
+void Col::updateTile(Tile *tile)
+{
+	if (_item)
+		_item->update(tile->rect());
+}
+
+bool Col::wantsItem(Tile *tile) const
+{
+	if (_item || !_visible || tile->index() == -1 || tile == scene()->dragging())
+		return false;
+	return !scene()->isVirtualized() || scene()->shownRect().intersects(tile->rect());
+}
+
+void Col::updateItem(Tile *tile)
+{
+	if (wantsItem(tile)) {
+		if (!tile->item())
+			scene()->takeItem(tile);
+	} else if (tile->item() && scene()->mouseGrabberItem() != tile->item())
+		scene()->releaseItem(tile);
+}
+
+void Col::updateItems()
 {
 	foreach (Tile *tile, _tiles)
-		if (tile->text() == text)
-			return tile;
+		updateItem(tile);
+}
+
+void Col::updateItems(const QRectF &rect)
+{
+	QVarLengthArray<Tile*, 256> tiles;
+	findIn(rect, &tiles);
+	foreach (Tile *tile, tiles)
+		updateItem(tile);
+}
+
+Tile *Col::tileAt(const QPointF &pos) const
+{
+	for (int i = band(pos.y() - _tileHeight), end = band(pos.y()); i <= end; ++i) {
+		QHash<int, QList<Tile*> >::const_iterator tiles = _bands.constFind(i);
+		if (tiles == _bands.constEnd())
+			continue;
+
+		foreach (Tile *tile, *tiles)
+			if (tile->rect().contains(pos))
+				return tile;
+	}
+
 	return NULL;
 }
 
+void Col::setBatched(bool batched)
+{
+	if (batched == this->batched())
+		return;
+
+	if (batched) {
+		_item = new ColItem(this);
+		_item->setVisible(_visible);
+		_item->setBounds(QRectF(_tiles.isEmpty() ? QPointF() : _tiles.first()->pos(), QSizeF(_width, _height)));
+		foreach (Tile *tile, _tiles)
+			_item->include(tile);
+		scene()->addItem(_item);
+	} else {
+		delete _item;
+		_item = NULL;
+	}
+	updateItems();
+}
+
+void Col::trimTiles(int keep)
+{
+	while (_freeTiles.size() > keep)
+		delete _freeTiles.takeLast();
+}
+
 Tile *Col::addTile(const QString &text)
 {
-	Tile *tile = new Tile(text, find(text));
-	tile->setVisible(_visible);
+	Tile *tile;
+	if (_freeTiles.isEmpty()) {
+		tile = new Tile(text, this);
+		++_tileAllocations;
+	} else {
+		tile = _freeTiles.takeLast();
+		tile->recycle(text);
+	}
+	QList<Tile*> &group = _dups[text];
+	tile->setDupIndex(group.size());
+	group.append(tile);
+	tile->setBand(band(tile->y()));
+	_bands[tile->band()].append(tile);
 	tile->setMovable(_movable);
-	connect(tile, SIGNAL(removed(Tile*)),
-	        this, SLOT(removeTile(Tile*)));
+	tile->setIndex(_tiles.size());
 	_tiles.append(tile);
-	_width = qMax(_width, tile->boundingRect().width());
-	emit itemCountChanged(_tiles.size());
+	_dirty = qMin(_dirty, tile->index());
+	_width = qMax(_width, tile->size().width());
+	++_widths[tile->size().width()];
+	_tileHeight = qMax(_tileHeight, tile->size().height());
+	countChanged();
 	return tile;
 }
 
 void Col::clear()
 {
-	foreach (Tile *tile, _tiles)
-		tile->deleteLater();
+	QList<Tile*> tiles = _tiles;
 	_tiles.clear();
+	_dups.clear();
+	_bands.clear();
+	_widths.clear();
 	_width = 0;
+	_dirty = 0;
+
+	foreach (Tile *tile, tiles) {
+		tile->setBand(Tile::NoBand);
+		tile->setIndex(-1);
+		tile->setDupIndex(-1);
+		scene()->releaseTile(tile);
+	}
+	if (_item) {
+		_item->clearCache();
+		_item->update();
+	}
+	countChanged();
 }
 
-void Col::calcWidth()
+/* The scene counts the rows on the board by the tiles in the first column */
+void Col::countChanged()
 {
-	foreach (Tile *tile, _tiles)
-		_width = qMax(_width, tile->boundingRect().width());
+	if (!_group)
+		scene()->setRowCount(_tiles.size());
+}
+
+void Col::reindex(int from)
+{
+	for (int i = from; i < _tiles.size(); ++i)
+		_tiles.at(i)->setIndex(i);
+	_dirty = qMin(_dirty, from);
 }
 
 void Col::removeTile(Tile *tile)
 {
-	_tiles.removeOne(tile);
-	emit itemCountChanged(_tiles.size());
-	if (tile->boundingRect().width() == _width)
-		calcWidth();
+	int i = tile->index();
+	if (i < 0 || i >= _tiles.size() || _tiles.at(i) != tile)
+		return;
+
+	removeDup(tile);
+	tile->setIndex(-1);
+	if (_layout == Shuffle && i != _tiles.size() - 1) {
+		/* Shuffled tiles are in no order, so the last one moves into the
+		 * hole instead of every tile after it moving up */
+		Tile *last = _tiles.takeLast();
+		_tiles[i] = last;
+		last->setIndex(i);
+		_dirty = qMin(_dirty, _tiles.size());
+		if (i < _dirty) {
+			last->setSlot(tile->slot());
+			last->setPos(last->x(), tile->slot());
+		}
+	} else {
+		_tiles.removeAt(i);
+		reindex(i);
+	}
+
+	if (tile->band() != Tile::NoBand)
+		unband(tile);
+	if (_item)
+		_item->remove(tile);
+
+	QMap<qreal, int>::iterator width = _widths.find(tile->size().width());
+	if (!--*width)
+		_widths.erase(width);
+	_width = _widths.isEmpty() ? 0 : (_widths.end() - 1).key();
+
+	countChanged();
 }
 
 void Col::reveal(bool shown)
@@ -84,12 +347,14 @@ void Col::reveal(bool shown)
 
 void Col::setSorted()
 {
+	TileScene::Action action(scene(), "sort " + QByteArray::number(_group));
 	_layout = Sort;
 	emit layoutChanged();
 }
 
 void Col::setShuffled()
 {
+	TileScene::Action action(scene(), "shuffle " + QByteArray::number(_group));
 	_layout = Shuffle;
 	emit layoutChanged();
 }
@@ -104,42 +369,75 @@ void Col::toggleMovable()
 void Col::toggleVisible()
 {
 	_visible = !_visible;
-	foreach (Tile *tile, _tiles)
-		tile->setVisible(_visible);
+	updateItems();
+	if (_item)
+		_item->setVisible(_visible);
 }
 
 void Col::layout()
 {
+	Trace::Span span("Col::layout");
 	switch (_layout) {
 	case Shuffle:
-		for (int i = 0, len = _tiles.size(); i != len - 1; ++i)
-			_tiles.swap(i, i + rand() % (len - i));
+		for (int i = 0, len = _tiles.size(); i < len - 1; ++i)
+			_tiles.swap(i, i + _random.uniform(len - i));
 		break;
 	case Sort:
 		qSort(_tiles.begin(), _tiles.end(), Tile::lessThan);
 		break;
 	}
+
+	reindex(0);
+}
+
+void Col::invalidate()
+{
+	_dirty = 0;
 }
 
 void Col::place(int xoffset, int yoffset)
 {
+	Trace::Span span("Col::place");
+	if (xoffset != _x || yoffset != _y) {
+		_x = xoffset;
+		_y = yoffset;
+		_dirty = 0;
+	}
+
 	QPointF pos(xoffset, yoffset);
+	if (_dirty) {
+		Tile *prev = _tiles.at(_dirty - 1);
+		pos.ry() = prev->slot() + prev->size().height() * 1.5;
+	}
 
-	foreach (Tile *tile, _tiles) {
+	for (int i = _dirty; i != _tiles.size(); ++i) {
+		Tile *tile = _tiles.at(i);
+		tile->setSlot(pos.y());
 		tile->setPos(pos);
-		pos.ry() += tile->boundingRect().height() * 1.5;
+		pos.ry() += tile->size().height() * 1.5;
+	}
+
+	_dirty = _tiles.size();
+
+	if (_tiles.isEmpty())
+		_height = yoffset;
+	else {
+		Tile *last = _tiles.last();
+		_height = last->slot() + last->size().height() * 1.5;
 	}
 
-	_height = pos.y();
+	if (_item)
+		_item->setBounds(QRectF(xoffset, yoffset, _width, _height - yoffset));
 }
 
 void Col::reset()
 {
 	foreach (Tile *tile, _tiles)
-		tile->row()->unbind();
+		if (tile->row())
+			tile->row()->unbind();
 }
 
 Tile *Col::randTile()
 {
-	return _tiles.at(rand() % _tiles.size());
+	return _tiles.at(_random.uniform(_tiles.size()));
 }
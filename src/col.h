@@ -19,8 +19,15 @@
 #ifndef COL_H
 #define COL_H
 
+#include <QHash>
+#include <QMap>
 #include <QObject>
+#include <QVarLengthArray>
+#include "random.h"
 
+class ColItem;
+class QPointF;
+class QRectF;
 class Row;
 class Tile;
 class TileScene;
@@ -35,30 +42,71 @@ public:
 	};
 
 	Col(TileScene *parent, int group, LayoutMode);
+	~Col();
 
+	/* Tiles that have left the board are kept, and used again before any
+	 * new one is made */
 	Tile *addTile(const QString &text);
+	inline void recycleTile(Tile *tile) { _freeTiles.append(tile); }
+	/* Deletes all but keep of the tiles kept */
+	void trimTiles(int keep);
+	inline int tileAllocations() const { return _tileAllocations; }
 
 	void reset();
 	void reveal(bool shown);
 	void clear();
 
-	Tile *find(const QString &text);
+	/* All tiles in this column with the given text */
+	const QList<Tile*> &dups(const QString &text) const;
+	/* Appends the tiles that a tile dropped at y lines up with */
+	void findNear(int y, QVarLengthArray<Tile*, 32> *result) const;
+	/* Tiles that intersect rect, found through the bands */
+	void findIn(const QRectF &rect, QVarLengthArray<Tile*, 256> *result) const;
+	/* Called by a tile after it moved from from */
+	void moveTile(Tile *tile, const QPointF &from);
+	/* A lifted tile is left out of the bands and has no item, so moving
+	 * it costs nothing, until it is settled again where it was dropped */
+	void liftTile(Tile *tile);
+	void settleTile(Tile *tile);
+	void updateTile(Tile *tile);
+	Tile *tileAt(const QPointF &pos) const;
 	Tile *randTile();
+	/* Each column shuffles and picks from a stream of its own */
+	inline void setSeed(quint64 seed) { _random.setSeed(seed); }
 
 	void layout();
+	/* Only tiles whose slot changed since the last call are moved, unless
+	 * the column itself moved or invalidate() was called. */
 	void place(int x, int y);
+	void invalidate();
 
 	inline bool movable() const { return _movable; }
 	inline bool visible() const { return _visible; }
 	inline int index() const { return _group; }
 	inline LayoutMode layoutMode() const { return _layout; }
+	inline void setLayoutMode(LayoutMode mode) { _layout = mode; }
 	inline QList<Tile*> *tiles() { return &_tiles; }
 	inline qreal height() const { return _height; }
 	inline qreal width() const { return _width; }
+	TileScene *scene() const;
+
+	/* In batched mode the whole column is drawn by one ColItem */
+	inline bool batched() const { return _item; }
+	void setBatched(bool batched);
+	/* Gives an item to each tile that should have one and takes it from
+	 * each that should not: every tile on a visible column that is not
+	 * batched, or in virtualized mode only the tiles in the scene's shown
+	 * rect. A tile being dragged keeps its item. */
+	void updateItem(Tile *tile);
+	void updateItems();
+	/* Only for the tiles in rect, which must include every tile that has
+	 * an item */
+	void updateItems(const QRectF &rect);
+
+	void removeTile(Tile *tile);
 
 signals:
 	void layoutChanged();
-	void itemCountChanged(int);
 
 public slots:
 	void toggleMovable();
@@ -66,19 +114,37 @@ public slots:
 	void setSorted();
 	void setShuffled();
 
-protected slots:
-	void removeTile(Tile *tile);
-
 private:
-	void calcWidth();
+	/* Tiles are indexed by which band of this height their y falls in */
+	static const int BandHeight = 16;
+	static int band(qreal y);
+
+	void reindex(int from);
+	void countChanged();
+	void unband(Tile *tile);
+	void removeDup(Tile *tile);
+	bool wantsItem(Tile *tile) const;
 
 	QList<Tile*> _tiles;
+	QHash<QString, QList<Tile*> > _dups;
+	QHash<int, QList<Tile*> > _bands;
+	/* How many tiles there are of each width, to know the widest */
+	QMap<qreal, int> _widths;
+	ColItem *_item;
 	bool _movable;
 	bool _visible;
 	LayoutMode _layout;
 	int _group;
 	qreal _height;
 	qreal _width;
+	qreal _tileHeight;
+	int _x;
+	int _y;
+	/* Tiles from this index on are not in their slots */
+	int _dirty;
+	Random _random;
+	QList<Tile*> _freeTiles;
+	int _tileAllocations;
 };
 
 #endif
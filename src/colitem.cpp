@@ -0,0 +1,137 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "col.h"
+#include "colitem.h"
+#include <QGraphicsSceneMouseEvent>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include "tile.h"
+#include "tilescene.h"
+
+ColItem::ColItem(Col *col)
+	: _col(col)
+	, _dragging(NULL)
+{
+	setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+QRectF ColItem::boundingRect() const
+{
+	return _bounds;
+}
+
+void ColItem::include(Tile *tile)
+{
+	QRectF rect = tile->rect();
+	if (!_bounds.contains(rect)) {
+		prepareGeometryChange();
+		_bounds |= rect;
+	}
+}
+
+void ColItem::setBounds(const QRectF &rect)
+{
+	if (rect != _bounds) {
+		prepareGeometryChange();
+		_bounds = rect;
+	}
+}
+
+void ColItem::remove(Tile *tile)
+{
+	if (tile == _dragging)
+		_dragging = NULL;
+	update(tile->rect());
+}
+
+void ColItem::clearCache()
+{
+	_texts.clear();
+}
+
+const QStaticText &ColItem::staticText(const QString &text)
+{
+	QHash<QString, QStaticText>::iterator i = _texts.find(text);
+	if (i == _texts.end()) {
+		i = _texts.insert(text, QStaticText(text));
+		i->setPerformanceHint(QStaticText::AggressiveCaching);
+	}
+	return *i;
+}
+
+/*
+ * Only the tiles in the exposed part are drawn, so the cost of a paint
+ * depends on how much of the column is on screen rather than on its length.
+ */
+void ColItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*)
+{
+	QVarLengthArray<Tile*, 256> tiles;
+	_col->findIn(option->exposedRect, &tiles);
+
+	foreach (Tile *tile, tiles)
+		if (tile != _dragging)
+			draw(painter, tile);
+
+	/* Last, so it is over the others */
+	if (_dragging && option->exposedRect.intersects(_dragging->rect()))
+		draw(painter, _dragging);
+}
+
+void ColItem::draw(QPainter *painter, Tile *tile)
+{
+	if (tile->drawCached(painter, tile->pos()))
+		return;
+	painter->setFont(Tile::font());
+	painter->setPen(tile->color());
+	painter->drawStaticText(tile->pos(), staticText(tile->text()));
+}
+
+void ColItem::mousePressEvent(QGraphicsSceneMouseEvent *ev)
+{
+	Tile *tile = _col->tileAt(ev->pos());
+	if (!tile || !tile->isMovable()) {
+		ev->ignore();
+		return;
+	}
+
+	/* Over the other columns while it is dragged */
+	_dragging = tile;
+	setZValue(1);
+	update(tile->rect());
+	ev->accept();
+}
+
+void ColItem::mouseMoveEvent(QGraphicsSceneMouseEvent *ev)
+{
+	if (_dragging)
+		_dragging->setPos(_dragging->pos() + ev->scenePos() - ev->lastScenePos());
+}
+
+void ColItem::mouseReleaseEvent(QGraphicsSceneMouseEvent*)
+{
+	Tile *tile = _dragging;
+	if (!tile)
+		return;
+
+	_dragging = NULL;
+	setZValue(0);
+	update(tile->rect());
+
+	_col->scene()->dropTile(tile);
+}
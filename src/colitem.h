@@ -0,0 +1,64 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COLITEM_H
+#define COLITEM_H
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QStaticText>
+
+class Col;
+class Tile;
+
+/*
+ * Draws all the tiles of a column as a single scene item, so the scene only
+ * indexes and paints one item per column. The tiles have no items of their
+ * own; a drag moves the tile itself, which is drawn over the others until
+ * it is dropped.
+ */
+class ColItem : public QGraphicsItem {
+public:
+	ColItem(Col *col);
+
+	QRectF boundingRect() const;
+	void paint(QPainter*, const QStyleOptionGraphicsItem*, QWidget*);
+
+	/* Grow the bounds to include the tile, wherever it is now */
+	void include(Tile *tile);
+	void setBounds(const QRectF &rect);
+	/* The tile has been taken out of the column */
+	void remove(Tile *tile);
+	void clearCache();
+
+protected:
+	void mousePressEvent(QGraphicsSceneMouseEvent*);
+	void mouseMoveEvent(QGraphicsSceneMouseEvent*);
+	void mouseReleaseEvent(QGraphicsSceneMouseEvent*);
+
+private:
+	const QStaticText &staticText(const QString &text);
+	void draw(QPainter *painter, Tile *tile);
+
+	Col *_col;
+	Tile *_dragging;
+	QRectF _bounds;
+	QHash<QString, QStaticText> _texts;
+};
+
+#endif
@@ -0,0 +1,413 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include "deck.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTemporaryFile>
+#include "replacefile.h"
+#include <zlib.h>
+
+/*
+ * Layout of a compiled deck: this header, then the text of the deck exactly
+ * as it was read, then (aligned to four bytes) the offset index, with
+ * columns + 1 entries per line. Offsets are relative to the start of the
+ * text. Everything is in native byte order; a file written on a machine of
+ * the other endianness fails the version check and is ignored.
+ */
+struct Deck::Header {
+	char magic[4];
+	quint32 version;
+	quint32 columns;
+	quint32 lines;
+	qint64 sourceSize;
+	qint64 sourceTime;
+	quint32 textOffset;
+	quint32 textLength;
+	quint32 indexOffset;
+	quint32 reserved;
+};
+
+static const char Magic[4] = { 'I', 'N', 'Q', 'D' };
+static const quint32 Version = 2;
+
+Deck::Deck(const QString &file)
+	: _file(file)
+	, _data(NULL)
+	, _length(0)
+	, _columns(0)
+	, _size(0)
+	, _offsets(NULL)
+{
+}
+
+QString Deck::cacheDir()
+{
+	return QDir::homePath() + "/.cache/inquest";
+}
+
+Deck *Deck::load(const QString &file, QString *error, bool cache)
+{
+	Deck *deck = new Deck(file);
+	if (!deck->map(error)) {
+		delete deck;
+		return NULL;
+	}
+
+	if (deck->attach(NULL))
+		return deck;
+
+	QFileInfo info(file);
+	QString cached;
+
+	if (cache) {
+		QByteArray key = QCryptographicHash::hash(info.absoluteFilePath().toUtf8(), QCryptographicHash::Sha1);
+		cached = cacheDir() + '/' + key.toHex() + ".deck";
+
+		QString ignored;
+		Deck *compiled = new Deck(cached);
+		if (compiled->map(&ignored) && compiled->attach(&info)) {
+			delete deck;
+			return compiled;
+		}
+		delete compiled;
+	}
+
+	if (!deck->index(error)) {
+		delete deck;
+		return NULL;
+	}
+
+	if (cache)
+		deck->compile(cached, info);
+
+	return deck;
+}
+
+Deck *Deck::read(const QString &file, QString *error)
+{
+	Deck *deck = new Deck(file);
+	if (!deck->map(error, true)
+	 || (!deck->attach(NULL) && !deck->index(error))) {
+		delete deck;
+		return NULL;
+	}
+
+	return deck;
+}
+
+bool Deck::map(QString *error, bool copy)
+{
+	if (!_file.open(QFile::ReadOnly)) {
+		*error = _file.errorString();
+		return false;
+	}
+
+	qint64 length = _file.size();
+	if (length > 0xffffffffLL) {
+		*error = "File '" + _file.fileName() + "' is too large.";
+		return false;
+	}
+
+	_length = length;
+	if (!_length) {
+		if (copy)
+			_file.close();
+		return true;
+	}
+
+	if (!copy) {
+		_data = (const char*)_file.map(0, _length);
+		if (_data)
+			return true;
+	}
+
+	/* When asked to, or when the file system cannot map files */
+	_text = _file.readAll();
+	_file.close();
+	if (_text.size() != length) {
+		*error = "Could not read '" + _file.fileName() + "'.";
+		return false;
+	}
+	_data = _text.constData();
+	return true;
+}
+
+/*
+ * Use the mapped file as a compiled deck, if it is one. If source is given,
+ * the deck must have been compiled from that file as it is now.
+ */
+bool Deck::attach(const QFileInfo *source)
+{
+	if (!_data || _length < sizeof(Header))
+		return false;
+
+	const Header *h = (const Header*)_data;
+	if (memcmp(h->magic, Magic, sizeof(Magic)) || h->version != Version)
+		return false;
+
+	if (source && (h->sourceSize != source->size() || h->sourceTime != source->lastModified().toMSecsSinceEpoch()))
+		return false;
+
+	if (h->columns < 2 || h->columns > 0xffff)
+		return false;
+
+	quint32 stride = h->columns + 1;
+	if (h->textOffset > _length || h->textLength > _length - h->textOffset
+	 || h->indexOffset % 4 || h->indexOffset > _length
+	 || h->lines > (_length - h->indexOffset) / 4 / stride)
+		return false;
+
+	/* Check the index once here so fields() never has to */
+	const quint32 *offsets = (const quint32*)(_data + h->indexOffset);
+	for (const quint32 *o = offsets, *end = o + h->lines * stride; o != end; o += stride) {
+		for (quint32 i = 0; i != h->columns - 1; ++i)
+			if (o[i] >= o[i + 1])
+				return false;
+		if (o[h->columns - 1] > o[h->columns] || o[h->columns] > h->textLength)
+			return false;
+	}
+
+	_columns = h->columns;
+	_size = h->lines;
+	_offsets = offsets;
+	_data += h->textOffset;
+	_length = h->textLength;
+
+	return true;
+}
+
+bool Deck::index(QString *error)
+{
+	if (_length >= 2 && (uchar)_data[0] == 0x1f && (uchar)_data[1] == 0x8b) {
+		if (!decompress(error))
+			return false;
+	} else {
+		_index.reserve(_length / 16);
+		indexLines(_data, 0, _length, true);
+	}
+
+	if (_columns < 2) {
+		*error = "File '" + _file.fileName() + "' does not look like a tab-separated value file.";
+		return false;
+	}
+
+	_index.squeeze();
+	_offsets = _index.constData();
+
+	return true;
+}
+
+/*
+ * Index the complete lines of text between from and to, and return where
+ * the first line that is not complete yet starts. If last is true, the
+ * text ends at to, with or without a newline. The first line decides the
+ * number of columns.
+ */
+quint32 Deck::indexLines(const char *text, quint32 from, quint32 to, bool last)
+{
+	const char *p = text + from;
+	const char *end = text + to;
+
+	if (!from && to >= 3 && !memcmp(p, "\xef\xbb\xbf", 3))
+		p += 3;
+
+	while (p < end) {
+		if (_columns == 1)
+			return to;
+
+		const char *eol = (const char*)memchr(p, '\n', end - p);
+		if (!eol) {
+			if (!last)
+				break;
+			eol = end;
+		}
+
+		const char *stop = eol;
+		if (stop != p && stop[-1] == '\r')
+			--stop;
+
+		if (!_columns) {
+			_columns = 1;
+			for (const char *c = p; c != stop; ++c)
+				if (*c == '\t')
+					++_columns;
+			if (_columns == 1)
+				return to;
+		}
+
+		int start = _index.size();
+		_index.append(p - text);
+
+		const char *field = p;
+		int i = 1;
+		for (; i != _columns; ++i) {
+			field = (const char*)memchr(field, '\t', stop - field);
+			if (!field)
+				break;
+			_index.append(++field - text);
+		}
+
+		/* Lines with too few fields are skipped, as before */
+		if (i == _columns) {
+			_index.append(stop - text);
+			++_size;
+		} else
+			_index.resize(start);
+
+		p = eol + 1;
+	}
+
+	return qMin(end, p) - text;
+}
+
+/*
+ * Inflate a gzip file from the mapping a chunk at a time, indexing each
+ * chunk as it comes out, so the text is only gone through once. The
+ * mapping of the compressed file is dropped once the text is out.
+ */
+bool Deck::decompress(QString *error)
+{
+	const int Chunk = 256 * 1024;
+
+	/* If the file was read rather than mapped, the text takes its place */
+	QByteArray packed;
+	if (_data == _text.constData()) {
+		packed = _text;
+		_text.clear();
+	}
+
+	z_stream z;
+	memset(&z, 0, sizeof(z));
+	if (inflateInit2(&z, 16 + MAX_WBITS) != Z_OK) {
+		*error = "Could not start reading '" + _file.fileName() + "'.";
+		return false;
+	}
+
+	z.next_in = (Bytef*)_data;
+	z.avail_in = _length;
+	_index.reserve(_length / 4);
+
+	quint32 indexed = 0;
+	int ret = Z_OK;
+	do {
+		int size = _text.size();
+		if (size > 0x7fffffff - Chunk) {
+			*error = "File '" + _file.fileName() + "' is too large.";
+			break;
+		}
+
+		_text.resize(size + Chunk);
+		z.next_out = (Bytef*)_text.data() + size;
+		z.avail_out = Chunk;
+		ret = inflate(&z, Z_NO_FLUSH);
+		_text.resize(size + Chunk - z.avail_out);
+
+		/* Files may hold several gzip members one after another */
+		if (ret == Z_STREAM_END && z.avail_in) {
+			inflateReset(&z);
+			ret = Z_OK;
+		} else if (ret == Z_BUF_ERROR && !z.avail_in)
+			ret = Z_DATA_ERROR;
+
+		if (ret != Z_OK && ret != Z_STREAM_END)
+			*error = "File '" + _file.fileName() + "' is not a valid gzip file.";
+		else
+			indexed = indexLines(_text.constData(), indexed, _text.size(), false);
+	} while (ret == Z_OK && error->isEmpty());
+
+	inflateEnd(&z);
+	if (!error->isEmpty())
+		return false;
+
+	indexLines(_text.constData(), indexed, _text.size(), true);
+
+	if (packed.isNull()) {
+		_file.unmap((uchar*)_data);
+		_file.close();
+	}
+	_text.squeeze();
+	_data = _text.constData();
+	_length = _text.size();
+
+	return true;
+}
+
+bool Deck::compile(const QString &file, const QFileInfo &source) const
+{
+	qint64 count = qint64(_size) * (_columns + 1);
+	if (sizeof(Header) + 3 + _length + count * 4 > 0xffffffffLL)
+		return false;
+
+	QDir().mkpath(QFileInfo(file).path());
+	QTemporaryFile out(file + ".XXXXXX");
+	if (!out.open())
+		return false;
+
+	Header h;
+	memcpy(h.magic, Magic, sizeof(Magic));
+	h.version = Version;
+	h.columns = _columns;
+	h.lines = _size;
+	h.sourceSize = source.size();
+	h.sourceTime = source.lastModified().toMSecsSinceEpoch();
+	h.textOffset = sizeof(Header);
+	h.textLength = _length;
+	h.indexOffset = (h.textOffset + h.textLength + 3) & ~3u;
+	h.reserved = 0;
+
+	static const char padding[4] = { 0, 0, 0, 0 };
+	qint64 pad = h.indexOffset - h.textOffset - h.textLength;
+
+	if (out.write((const char*)&h, sizeof(h)) != sizeof(h)
+	 || out.write(_data, _length) != _length
+	 || out.write(padding, pad) != pad
+	 || out.write((const char*)_offsets, count * 4) != count * 4)
+		return false;
+
+	/* Another process may have the old cache mapped */
+	QString error;
+	return replaceFile(&out, file, &error);
+}
+
+QStringList Deck::fields(int line) const
+{
+	const quint32 *o = _offsets + line * (_columns + 1);
+	QStringList result;
+
+	for (int i = 0; i != _columns - 1; ++i)
+		result.append(QString::fromUtf8(_data + o[i], o[i + 1] - o[i] - 1));
+
+	/* The last field runs up to the next tab, if there are extra fields */
+	const char *start = _data + o[_columns - 1];
+	const char *stop = _data + o[_columns];
+	const char *tab = (const char*)memchr(start, '\t', stop - start);
+	result.append(QString::fromUtf8(start, (tab ? tab : stop) - start));
+
+	return result;
+}
+
+QByteArray Deck::line(int line) const
+{
+	const quint32 *o = _offsets + line * (_columns + 1);
+	return QByteArray::fromRawData(_data + o[0], o[_columns] - o[0]);
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DECK_H
+#define DECK_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QSharedData>
+#include <QVector>
+
+class QFileInfo;
+class QStringList;
+
+/*
+ * A tab-separated word list, memory-mapped and indexed in place. Nothing is
+ * copied out of the file until a line is asked for, so loading a deck costs
+ * one pass over the bytes plus a few offsets per line. Files that cannot be
+ * mapped are read into memory instead.
+ *
+ * A deck can also be compiled: the text is stored together with its index
+ * so that it can be mapped and used without parsing anything. See compile().
+ *
+ * Gzip files are recognized by their first bytes and inflated into memory
+ * as they are indexed.
+ */
+class Deck : public QSharedData {
+public:
+	/* Returns NULL and sets error if the file can't be used. If cache is
+	 * true, a compiled copy of a text file is kept in cacheDir() and used
+	 * instead of the original while it is still up to date. */
+	static Deck *load(const QString &file, QString *error, bool cache = false);
+	/* Like load() without the cache, but the file is read into memory and
+	 * closed. On Windows a file that is open or mapped cannot be replaced,
+	 * so this is how to use a file that is replaced while in use. */
+	static Deck *read(const QString &file, QString *error);
+	static QString cacheDir();
+
+	inline int size() const { return _size; }
+	inline int columns() const { return _columns; }
+	inline QString fileName() const { return _file.fileName(); }
+
+	QStringList fields(int line) const;
+	/* Raw bytes of the line, without the newline. Only valid while the deck
+	 * is alive. */
+	QByteArray line(int line) const;
+
+	bool compile(const QString &file, const QFileInfo &source) const;
+
+private:
+	struct Header;
+
+	Deck(const QString &file);
+	/* Reads the file into _text instead if copy is true */
+	bool map(QString *error, bool copy = false);
+	bool attach(const QFileInfo *source);
+	bool index(QString *error);
+	quint32 indexLines(const char *text, quint32 from, quint32 to, bool last);
+	bool decompress(QString *error);
+
+	QFile _file;
+	const char *_data;
+	quint32 _length;
+	int _columns;
+	int _size;
+	/* For each line, the start of each of the first _columns fields followed
+	 * by the end of the line. Points either into _index or into the file. */
+	const quint32 *_offsets;
+	QVector<quint32> _index;
+	/* The text of a compressed file */
+	QByteArray _text;
+};
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include "gzipwriter.h"
+
+GzipWriter::GzipWriter(QIODevice *out, int level)
+	: _out(out)
+	, _level(level)
+	, _failed(false)
+{
+	memset(&_z, 0, sizeof(_z));
+}
+
+GzipWriter::~GzipWriter()
+{
+	close();
+}
+
+bool GzipWriter::open(OpenMode mode)
+{
+	if (mode != WriteOnly)
+		return false;
+
+	if (deflateInit2(&_z, _level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		setErrorString("Could not start compressing.");
+		return false;
+	}
+
+	return QIODevice::open(mode);
+}
+
+void GzipWriter::close()
+{
+	if (!isOpen())
+		return;
+
+	if (!deflateTo(Z_FINISH))
+		_failed = true;
+	deflateEnd(&_z);
+	QIODevice::close();
+}
+
+qint64 GzipWriter::readData(char*, qint64)
+{
+	return -1;
+}
+
+qint64 GzipWriter::writeData(const char *data, qint64 length)
+{
+	/* avail_in is only 32 bits */
+	for (qint64 done = 0; done != length; ) {
+		uInt size = qMin<qint64>(length - done, 1 << 30);
+		_z.next_in = (Bytef*)data + done;
+		_z.avail_in = size;
+		if (!deflateTo(Z_NO_FLUSH)) {
+			_failed = true;
+			return -1;
+		}
+		done += size;
+	}
+
+	return length;
+}
+
+bool GzipWriter::deflateTo(int flush)
+{
+	char buffer[64 * 1024];
+	int ret;
+
+	do {
+		_z.next_out = (Bytef*)buffer;
+		_z.avail_out = sizeof(buffer);
+		ret = deflate(&_z, flush);
+		if (ret == Z_STREAM_ERROR)
+			return false;
+
+		qint64 size = sizeof(buffer) - _z.avail_out;
+		if (_out->write(buffer, size) != size) {
+			setErrorString(_out->errorString());
+			return false;
+		}
+	} while (_z.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+
+	return true;
+}
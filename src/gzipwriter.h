@@ -0,0 +1,51 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GZIPWRITER_H
+#define GZIPWRITER_H
+
+#include <QIODevice>
+#include <zlib.h>
+
+/*
+ * Compresses what is written to it into another device, in gzip format.
+ * close() finishes the stream; failed() tells whether anything went wrong.
+ */
+class GzipWriter : public QIODevice {
+public:
+	GzipWriter(QIODevice *out, int level = Z_BEST_SPEED);
+	~GzipWriter();
+
+	bool open(OpenMode mode);
+	void close();
+	inline bool failed() const { return _failed; }
+
+protected:
+	qint64 readData(char*, qint64);
+	qint64 writeData(const char *data, qint64 length);
+
+private:
+	bool deflateTo(int flush);
+
+	QIODevice *_out;
+	z_stream _z;
+	int _level;
+	bool _failed;
+};
+
+#endif
@@ -0,0 +1,202 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "journal.h"
+#include <QDateTime>
+#include <QFileInfo>
+
+/*
+ * The first line is "INQJ 1 <snapshot size> <snapshot time>". Each line
+ * after it is a type character, a tab and the data: "c" and the text of a
+ * finished word, "r" and the due time, interval and text of a word that
+ * was reviewed, or "n" and the number of rows. Journals written before
+ * "r" have "p" or "f" and the time and text of a word that passed or
+ * failed a review instead; those are still read.
+ */
+static const char Magic[] = "INQJ 1";
+
+Journal::Journal()
+	: _events(0)
+	, _marked(false)
+{
+}
+
+QByteArray Journal::header(const QString &snapshot)
+{
+	QFileInfo info(snapshot);
+	return QByteArray(Magic) + ' ' + QByteArray::number(info.size())
+		+ ' ' + QByteArray::number(info.lastModified().toTime_t()) + '\n';
+}
+
+bool Journal::reset(const QString &file, const QString &snapshot, int rowCount)
+{
+	QList<QByteArray> pending = _pending;
+
+	close();
+	_error.clear();
+	_file.setFileName(file);
+	if (!_file.open(QFile::WriteOnly | QFile::Truncate)) {
+		_error = _file.errorString();
+		return false;
+	}
+
+	QByteArray data = header(snapshot);
+	foreach (const QByteArray &line, pending)
+		data += line;
+	_events = pending.size();
+	if (_file.write(data) != data.size()) {
+		fail();
+		return false;
+	}
+	return setRowCount(rowCount);
+}
+
+void Journal::mark()
+{
+	_marked = true;
+	_pending.clear();
+}
+
+void Journal::unmark()
+{
+	_marked = false;
+	_pending.clear();
+}
+
+bool Journal::open(const QString &file)
+{
+	close();
+	_error.clear();
+	_file.setFileName(file);
+	if (!_file.open(QFile::WriteOnly | QFile::Append)) {
+		_error = _file.errorString();
+		return false;
+	}
+	return true;
+}
+
+void Journal::close()
+{
+	_file.close();
+	_events = 0;
+	unmark();
+}
+
+bool Journal::read(const QString &file, const QString &snapshot, QHash<QByteArray, int> *done, int *rowCount, Reviews *reviews)
+{
+	QFile in(file);
+	if (!in.open(QFile::ReadOnly))
+		return false;
+
+	if (in.readLine() != header(snapshot))
+		return false;
+
+	while (!in.atEnd()) {
+		QByteArray line = in.readLine();
+		if (!line.endsWith('\n'))
+			break;
+		line.chop(1);
+
+		if (line.size() < 2 || line.at(1) != '\t')
+			continue;
+
+		QByteArray data = line.mid(2);
+		int tab, tab2;
+		Reviews::State state;
+		switch (line.at(0)) {
+		case 'c':
+			++(*done)[data];
+			break;
+		case 'r':
+			tab = data.indexOf('\t');
+			tab2 = data.indexOf('\t', tab + 1);
+			if (tab == -1 || tab2 == -1)
+				break;
+			state.due = data.left(tab).toLongLong();
+			state.interval = data.mid(tab + 1, tab2 - tab - 1).toLongLong();
+			reviews->set(data.mid(tab2 + 1), state);
+			break;
+		case 'p':
+		case 'f':
+			tab = data.indexOf('\t');
+			if (tab == -1)
+				break;
+			if (line.at(0) == 'p')
+				reviews->pass(data.mid(tab + 1), data.left(tab).toLongLong());
+			else
+				reviews->fail(data.mid(tab + 1), data.left(tab).toLongLong());
+			break;
+		case 'n':
+			if (data.toInt() > 0)
+				*rowCount = data.toInt();
+			break;
+		}
+	}
+
+	return true;
+}
+
+bool Journal::complete(const QByteArray &text)
+{
+	return append('c', text);
+}
+
+bool Journal::review(const QByteArray &text, const Reviews::State &state)
+{
+	return append('r', QByteArray::number(state.due) + '\t'
+		+ QByteArray::number(state.interval) + '\t' + text);
+}
+
+bool Journal::setRowCount(int count)
+{
+	return append('n', QByteArray::number(count));
+}
+
+/* Keeps the error and closes the file, so a failure is only reported once */
+void Journal::fail()
+{
+	_error = _file.errorString();
+	_file.close();
+}
+
+/* Flushed at once, so a crash loses at most the line being written */
+bool Journal::append(char type, const QByteArray &data)
+{
+	if (!_file.isOpen()) {
+		/* After a failure, the events are left for the next snapshot */
+		if (!_error.isEmpty())
+			++_events;
+		return true;
+	}
+
+	QByteArray line;
+	line.reserve(data.size() + 3);
+	line.append(type);
+	line.append('\t');
+	line.append(data);
+	line.append('\n');
+	++_events;
+	if (_file.write(line) != line.size() || !_file.flush()) {
+		fail();
+		return false;
+	}
+
+	if (_marked)
+		_pending.append(line);
+	return true;
+}
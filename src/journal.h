@@ -0,0 +1,83 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include "reviews.h"
+
+/*
+ * Changes to the session since the last snapshot of the state file, one
+ * line each, appended as they happen. The state file holds the words that
+ * are left; the journal holds the words finished since it was written, the
+ * reviews of words in scheduled mode and the number of rows on the board.
+ * The journal starts with the size and time of the snapshot it belongs to,
+ * so one left over from an older snapshot is ignored.
+ */
+class Journal {
+public:
+	Journal();
+
+	/* Start a journal on top of snapshot, which has just been written. It
+	 * holds the events since mark(), if mark() was called. */
+	bool reset(const QString &file, const QString &snapshot, int rowCount);
+	/* A snapshot is being taken; keep the events from here on for reset() */
+	void mark();
+	void unmark();
+	inline bool isMarked() const { return _marked; }
+	/* Keep appending to a journal that read() accepted */
+	bool open(const QString &file);
+	void close();
+	/* Why the last open(), reset() or append failed. After a failure the
+	 * journal is closed, and appends only count the events, so size() still
+	 * asks for the snapshot that resets it. */
+	inline QString errorString() const { return _error; }
+
+	/* Counts the words finished in the journal by their text, and applies
+	 * its reviews to reviews. rowCount is left alone unless the journal
+	 * records it. A partly written last line is ignored. */
+	static bool read(const QString &file, const QString &snapshot,
+	                 QHash<QByteArray, int> *done, int *rowCount,
+	                 Reviews *reviews);
+
+	bool complete(const QByteArray &text);
+	/* The state a review left the word in, rather than the review, so
+	 * reading the journal again on top of reviews that already have it
+	 * changes nothing */
+	bool review(const QByteArray &text, const Reviews::State &state);
+	bool setRowCount(int count);
+
+	/* Events appended since the last reset() */
+	inline int size() const { return _events; }
+
+private:
+	static QByteArray header(const QString &snapshot);
+	bool append(char type, const QByteArray &data);
+	void fail();
+
+	QFile _file;
+	QString _error;
+	int _events;
+	bool _marked;
+	QList<QByteArray> _pending;
+};
+
+#endif
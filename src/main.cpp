@@ -16,16 +16,82 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <ctime>
+#include <cstdio>
 #include "mainwindow.h"
+#include "perf.h"
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+#include "tilescene.h"
+#include "trace.h"
+
+/* Plays a recorded session as fast as it goes, and prints the time it
+ * took along with the counters of the hot paths */
+static int replay(const QString &file)
+{
+	TileScene scene;
+	QElapsedTimer timer;
+	QString error;
+
+	timer.start();
+	int actions = scene.replay(file, &error);
+	qint64 nsecs = timer.nsecsElapsed();
+
+	if (actions == -1) {
+		fprintf(stderr, "%s\n", qPrintable(error));
+		return 1;
+	}
+
+	QTextStream out(stdout);
+	out << "# name\tcount\tmean usec\ttotal usec\n";
+	out << "replay\t" << actions << '\t' << nsecs / 1000.0 / qMax(1, actions)
+	    << '\t' << nsecs / 1000.0 << '\n';
+
+	for (int i = 0; i != Perf::Counters; ++i) {
+		const Perf::Stat &stat = Perf::stat(Perf::Counter(i));
+		if (stat.count)
+			out << Perf::name(Perf::Counter(i)) << '\t' << stat.count << '\t'
+			    << stat.total / 1000.0 / stat.count << '\t' << stat.total / 1000.0 << '\n';
+	}
+
+	return 0;
+}
 
 int main(int argc, char **argv)
 {
-	srand(time(NULL));
 	QApplication app(argc, argv);
+
+	/* --replay FILE plays a recording; see TileScene::replay() */
+	int i = app.arguments().indexOf("--replay");
+	if (i != -1 && i + 1 < app.arguments().size())
+		return replay(app.arguments().at(i + 1));
+
+	/* --trace FILE records from the start and saves on the way out */
+	QString trace;
+	i = app.arguments().indexOf("--trace");
+	if (i != -1 && i + 1 < app.arguments().size()) {
+		trace = app.arguments().at(i + 1);
+		Trace::setEnabled(true);
+	}
+
 	MainWindow win;
 	win.show();
 	win.resize(400, 500);
-	return app.exec();
+
+	/* --record FILE records the session from its first round */
+	i = app.arguments().indexOf("--record");
+	if (i != -1 && i + 1 < app.arguments().size()) {
+		QString error;
+		if (!win.scene()->startRecording(app.arguments().at(i + 1), &error))
+			fprintf(stderr, "%s\n", qPrintable(error));
+	}
+
+	int result = app.exec();
+
+	QString error;
+	if (!trace.isEmpty() && !Trace::write(trace, &error))
+		fprintf(stderr, "%s\n", qPrintable(error));
+
+	return result;
 }
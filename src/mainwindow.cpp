@@ -20,10 +20,13 @@
 #include "mainwindow.h"
 #include <QAction>
 #include <QApplication>
+#include <QFileDialog>
 #include <QMenuBar>
+#include <QMessageBox>
 #include <QToolBar>
 #include "tilescene.h"
 #include "tileview.h"
+#include "trace.h"
 
 MainWindow *MainWindow::instance = NULL;
 
@@ -61,6 +64,11 @@ MainWindow::MainWindow()
 
 	file->addSeparator();
 
+	file->addAction("Record Session...", _scene, SLOT(record()));
+	file->addAction("Stop Recording", _scene, SLOT(stopRecording()));
+
+	file->addSeparator();
+
 	file->addAction("Quit, Saving Session", qApp, SLOT(closeAllWindows()))
 		->setShortcut(QKeySequence("Ctrl+Q"));
 	file->addAction("Quit, Discarding Session", _scene, SLOT(quitNow()))
@@ -81,6 +89,31 @@ MainWindow::MainWindow()
 	view->addAction("Relayout", _scene, SLOT(layout()))
 		->setShortcut(QKeySequence(QKeySequence::Refresh));
 
+	view->addSeparator();
+
+	QAction *batched = view->addAction("Draw Columns as One Item");
+	batched->setCheckable(true);
+	connect(batched, SIGNAL(toggled(bool)),
+	        _scene, SLOT(setBatched(bool)));
+	addToggle(view, "Show Only Tiles Near the View", _scene, SLOT(setVirtualized(bool)), false);
+	addToggle(view, "Low-Latency Dragging", _view, SLOT(setLowLatencyDrag(bool)), false);
+
+	QMenu *cache = view->addMenu("Tile Cache");
+	QActionGroup *group = new QActionGroup(this);
+	addToggle(cache, "Off", _scene, SLOT(setTileCacheOff()), false, group);
+	addToggle(cache, "16 MB", _scene, SLOT(setTileCacheSmall()), true, group);
+	addToggle(cache, "64 MB", _scene, SLOT(setTileCacheLarge()), false, group);
+
+	view->addSeparator();
+
+	QAction *hud = view->addAction("Show Performance Counters");
+	hud->setCheckable(true);
+	connect(hud, SIGNAL(toggled(bool)),
+	        _view, SLOT(setHudShown(bool)));
+	view->addAction("Copy Performance Counters as CSV", _view, SLOT(copyCounters()));
+	addToggle(view, "Record Trace", this, SLOT(setTracing(bool)), Trace::isEnabled());
+	view->addAction("Save Trace...", this, SLOT(saveTrace()));
+
 
 	QMenu *tiles = menu->addMenu("Tiles");
 	tiles->addAction("Reset", _scene, SLOT(reset()))
@@ -95,16 +128,25 @@ MainWindow::MainWindow()
 
 	_settingsMenu->addSeparator()->setText("Checking Mode");
 
-	QActionGroup *group = new QActionGroup(this);
+	group = new QActionGroup(this);
 	addToggle(_settingsMenu, "Check on Place", _scene, SLOT(setPlacementAuto()), true, group);
 	addToggle(_settingsMenu, "Check on Space Press", _scene, SLOT(setPlacementManual()), false, group);
 	addToggle(_settingsMenu, "Check when All Correct", _scene, SLOT(setPlacementNo()), false, group);
 
+	_settingsMenu->addSeparator()->setText("Drawing Mode");
+
+	group = new QActionGroup(this);
+	addToggle(_settingsMenu, "Draw Any Word", _scene, SLOT(setDrawUniform()), true, group);
+	addToggle(_settingsMenu, "Draw Evenly from Each File", _scene, SLOT(setDrawPerDeck()), false, group);
+	addToggle(_settingsMenu, "Draw Words That Are Due", _scene, SLOT(setDrawDue()), false, group);
+
 	_settingsMenu->addSeparator();
 
 	_count = menu->addAction("", _scene, SLOT(checkAdvance()));
 	connect(_scene, SIGNAL(countChanged(int, int)),
 	        this, SLOT(updateCount(int, int)));
+	connect(_scene, SIGNAL(loadProgress(int, int)),
+	        this, SLOT(updateLoadProgress(int, int)));
 
 	connect(_scene, SIGNAL(addRemoveGroup(Col*)),
 	        this, SLOT(addRemoveMenu(Col*)));
@@ -138,6 +180,24 @@ void MainWindow::updateCount(int correct, int remaining)
 	_count->setText(text);
 }
 
+void MainWindow::updateLoadProgress(int done, int total)
+{
+	_count->setText(QString("Loading %1/%2").arg(done).arg(total));
+}
+
+void MainWindow::setTracing(bool enabled)
+{
+	Trace::setEnabled(enabled);
+}
+
+void MainWindow::saveTrace()
+{
+	QString file = QFileDialog::getSaveFileName(this, QString(), QString(), "Chrome traces (*.json)");
+	QString error;
+	if (!file.isEmpty() && !Trace::write(file, &error))
+		QMessageBox::critical(this, "Error writing file", error);
+}
+
 void MainWindow::resizeEvent(QResizeEvent *ev)
 {
 	_view->fit(_scene->sceneRect());
@@ -36,11 +36,16 @@ public:
 
 	static MainWindow *instance;
 
+	inline TileScene *scene() const { return _scene; }
+
 public slots:
 	void updateCount(int correct, int remaining);
+	void updateLoadProgress(int done, int total);
 
 protected slots:
 	void addRemoveMenu(Col*);
+	void setTracing(bool);
+	void saveTrace();
 
 protected:
 	void resizeEvent(QResizeEvent*);
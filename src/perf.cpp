@@ -0,0 +1,39 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "perf.h"
+
+Perf::Stat Perf::_stats[Perf::Counters];
+
+void Perf::record(Counter counter, qint64 nsecs)
+{
+	Stat &stat = _stats[counter];
+	++stat.count;
+	stat.last = nsecs;
+	stat.total += nsecs;
+	stat.max = qMax(stat.max, nsecs);
+}
+
+const char *Perf::name(Counter counter)
+{
+	static const char *names[Counters] = {
+		"fill", "advance", "layout", "place", "checkRow", "paint",
+		"drag latency", "drop latency"
+	};
+	return names[counter];
+}
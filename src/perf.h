@@ -0,0 +1,70 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <QElapsedTimer>
+
+/*
+ * Running timings of the hot paths, for the overlay drawn by TileView.
+ * Only the GUI thread records them.
+ */
+class Perf {
+public:
+	enum Counter {
+		Fill,
+		Advance,
+		Layout,
+		Place,
+		CheckRow,
+		Paint,
+		/* From a mouse move or release during a drag to the end of the
+		 * next paint of the view */
+		DragLatency,
+		DropLatency
+	};
+	enum { Counters = DropLatency + 1 };
+
+	struct Stat {
+		int count;
+		qint64 last;
+		qint64 total;
+		qint64 max;
+	};
+
+	/* Times the scope it is declared in */
+	class Timer {
+	public:
+		Timer(Counter counter) : _counter(counter) { _timer.start(); }
+		~Timer() { record(_counter, _timer.nsecsElapsed()); }
+
+	private:
+		Counter _counter;
+		QElapsedTimer _timer;
+	};
+
+	static void record(Counter counter, qint64 nsecs);
+	static inline const Stat &stat(Counter counter) { return _stats[counter]; }
+	static const char *name(Counter counter);
+
+private:
+	static Stat _stats[Counters];
+};
+
+#endif
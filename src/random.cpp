@@ -0,0 +1,48 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "random.h"
+
+void Random::setSeed(quint64 seed)
+{
+	quint64 z = seed + Q_UINT64_C(0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * Q_UINT64_C(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)) * Q_UINT64_C(0x94d049bb133111eb);
+	z ^= z >> 31;
+	_state = z ? z : 1;
+}
+
+quint32 Random::next()
+{
+	_state ^= _state >> 12;
+	_state ^= _state << 25;
+	_state ^= _state >> 27;
+	return (_state * Q_UINT64_C(0x2545f4914f6cdd1d)) >> 32;
+}
+
+/* Values past the last whole multiple of n are drawn again, so that the
+ * low numbers are not favoured */
+int Random::uniform(int n)
+{
+	quint32 limit = 0xffffffffu - 0xffffffffu % n;
+	quint32 r;
+	do
+		r = next();
+	while (r >= limit);
+	return r % n;
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <QtGlobal>
+
+/*
+ * A small seedable generator (xorshift64*), so that a session can be
+ * played again with the same draws and shuffles. Seeds are mixed with
+ * splitmix64 first, so nearby seeds give unrelated streams.
+ */
+class Random {
+public:
+	Random(quint64 seed = 0) { setSeed(seed); }
+
+	void setSeed(quint64 seed);
+	quint32 next();
+	/* Uniformly distributed in [0, n) */
+	int uniform(int n);
+
+private:
+	quint64 _state;
+};
+
+#endif
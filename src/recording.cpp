@@ -0,0 +1,109 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "recording.h"
+
+/*
+ * The first line is "INQR 1", followed by "seed", "rows", "placement",
+ * "weighted" and "layout" lines that each hold a name, a space and the
+ * values. Recordings without a "weighted" line were drawn at random. Each line
+ * after them is a time, a tab and an action.
+ */
+static const char Magic[] = "INQR 1";
+
+QString Recording::wordsFile(const QString &file)
+{
+	return file + ".words.gz";
+}
+
+bool Recording::start(const QString &file, const Setup &setup)
+{
+	stop();
+	_file.setFileName(file);
+	if (!_file.open(QFile::WriteOnly | QFile::Truncate))
+		return false;
+
+	QByteArray data(Magic);
+	data += "\nseed " + QByteArray::number(setup.seed);
+	data += "\nrows " + QByteArray::number(setup.rows);
+	data += "\nplacement " + QByteArray::number(setup.placement);
+	data += "\nweighted " + QByteArray::number(int(setup.weighted));
+	data += "\nlayout";
+	foreach (int layout, setup.layouts)
+		data += ' ' + QByteArray::number(layout);
+	data += '\n';
+
+	_file.write(data);
+	_file.flush();
+	_clock.start();
+	return true;
+}
+
+void Recording::stop()
+{
+	_file.close();
+}
+
+/* Flushed at once, so a session that ends in a crash is still recorded */
+void Recording::append(const QByteArray &action)
+{
+	if (!_file.isOpen())
+		return;
+
+	_file.write(QByteArray::number(_clock.elapsed()) + '\t' + action + '\n');
+	_file.flush();
+}
+
+bool Recording::read(const QString &file, Setup *setup, QList<QByteArray> *actions)
+{
+	QFile in(file);
+	if (!in.open(QFile::ReadOnly))
+		return false;
+
+	if (in.readLine() != QByteArray(Magic) + '\n')
+		return false;
+
+	while (!in.atEnd()) {
+		QByteArray line = in.readLine();
+		if (!line.endsWith('\n'))
+			break;
+		line.chop(1);
+
+		int tab = line.indexOf('\t');
+		if (tab != -1) {
+			actions->append(line.mid(tab + 1));
+			continue;
+		}
+
+		QList<QByteArray> values = line.split(' ');
+		QByteArray name = values.takeFirst();
+		if (name == "seed" && !values.isEmpty())
+			setup->seed = values.first().toULongLong();
+		else if (name == "rows" && !values.isEmpty())
+			setup->rows = values.first().toInt();
+		else if (name == "placement" && !values.isEmpty())
+			setup->placement = values.first().toInt();
+		else if (name == "weighted" && !values.isEmpty())
+			setup->weighted = values.first().toInt();
+		else if (name == "layout")
+			foreach (const QByteArray &value, values)
+				setup->layouts.append(value.toInt());
+	}
+
+	return true;
+}
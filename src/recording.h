@@ -0,0 +1,63 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+
+/*
+ * A session recorded so it can be played again: the seed and settings the
+ * first round started with, and every action taken after that, one per
+ * line with the milliseconds since the start. The words that were left to
+ * draw are saved next to it, in wordsFile(). Replaying the actions on the
+ * same words with the same seed gives the same rounds.
+ */
+class Recording {
+public:
+	struct Setup {
+		Setup() : seed(0), rows(0), placement(0), weighted(false) { }
+
+		quint64 seed;
+		int rows;
+		int placement;
+		/* Whether words were drawn by deck weight rather than at random */
+		bool weighted;
+		/* The layout mode of each column */
+		QList<int> layouts;
+	};
+
+	static QString wordsFile(const QString &file);
+
+	bool start(const QString &file, const Setup &setup);
+	void stop();
+	inline bool isRecording() const { return _file.isOpen(); }
+	void append(const QByteArray &action);
+
+	/* The actions are returned without their times. A partly written last
+	 * line is ignored. */
+	static bool read(const QString &file, Setup *setup, QList<QByteArray> *actions);
+
+private:
+	QFile _file;
+	QElapsedTimer _clock;
+};
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QFile>
+#include <QTemporaryFile>
+#include "replacefile.h"
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+/* Rename from over to, replacing to in one step */
+static bool replaceFile(const QString &from, const QString &to)
+{
+#ifdef Q_OS_WIN
+	return MoveFileExW((const wchar_t*)from.utf16(), (const wchar_t*)to.utf16(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+	return !::rename(QFile::encodeName(from), QFile::encodeName(to));
+#endif
+}
+
+bool replaceFile(QTemporaryFile *store, const QString &file, QString *error)
+{
+#ifndef Q_OS_WIN
+	fsync(store->handle());
+#endif
+
+	QString name = store->fileName();
+	store->setAutoRemove(false);
+	store->close();
+	if (!replaceFile(name, file)) {
+		*error = "Could not replace '" + file + "'.";
+		QFile::remove(name);
+		return false;
+	}
+
+	return true;
+}
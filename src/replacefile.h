@@ -0,0 +1,33 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPLACEFILE_H
+#define REPLACEFILE_H
+
+class QString;
+class QTemporaryFile;
+
+/*
+ * Syncs store, closes it and renames it over file in one step. Files a
+ * Deck may have mapped are never truncated in place; a reader of the old
+ * file keeps its mapping until it lets go. On failure, store is removed
+ * and error is set.
+ */
+bool replaceFile(QTemporaryFile *store, const QString &file, QString *error);
+
+#endif
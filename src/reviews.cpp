@@ -0,0 +1,90 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QFile>
+#include "reviews.h"
+
+static const qint64 FirstInterval = 24 * 60 * 60;
+static const qint64 MaxInterval = 365 * FirstInterval;
+static const qint64 RetryInterval = 10 * 60;
+
+Reviews::State Reviews::pass(const QByteArray &text, qint64 now)
+{
+	State &state = _states[text];
+	state.interval = qBound(FirstInterval, state.interval * 2, MaxInterval);
+	state.due = now + state.interval;
+	return state;
+}
+
+Reviews::State Reviews::fail(const QByteArray &text, qint64 now)
+{
+	State &state = _states[text];
+	state.interval = 0;
+	state.due = now + RetryInterval;
+	return state;
+}
+
+bool Reviews::read(const QString &file)
+{
+	QFile in(file);
+	if (!in.open(QFile::ReadOnly))
+		return false;
+
+	while (!in.atEnd()) {
+		QByteArray line = in.readLine();
+		if (!line.endsWith('\n'))
+			break;
+		line.chop(1);
+
+		int a = line.indexOf('\t');
+		int b = line.indexOf('\t', a + 1);
+		if (a == -1 || b == -1)
+			continue;
+
+		State state;
+		state.due = line.left(a).toLongLong();
+		state.interval = line.mid(a + 1, b - a - 1).toLongLong();
+		_states.insert(line.mid(b + 1), state);
+	}
+
+	return true;
+}
+
+bool Reviews::write(QIODevice *out) const
+{
+	const int BlockSize = 1 << 20;
+	QByteArray block;
+	block.reserve(BlockSize + 4096);
+
+	QHash<QByteArray, State>::const_iterator i = _states.constBegin();
+	for (; i != _states.constEnd(); ++i) {
+		block += QByteArray::number(i->due);
+		block += '\t';
+		block += QByteArray::number(i->interval);
+		block += '\t';
+		block += i.key();
+		block += '\n';
+		if (block.size() >= BlockSize) {
+			if (out->write(block) != block.size())
+				return false;
+			block.resize(0);
+		}
+	}
+
+	return out->write(block) == block.size();
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REVIEWS_H
+#define REVIEWS_H
+
+#include <QHash>
+
+class QIODevice;
+
+/*
+ * When each word is due again, by its text. A word that is finished is
+ * due again after twice as long as last time, starting at a day; a word
+ * that is skipped is due again in ten minutes. Words never seen are due at
+ * once.
+ */
+class Reviews {
+public:
+	struct State {
+		State() : due(0), interval(0) { }
+
+		qint64 due;
+		qint64 interval;
+	};
+
+	inline bool isEmpty() const { return _states.isEmpty(); }
+	inline qint64 due(const QByteArray &text) const { return _states.value(text).due; }
+
+	/* Both return the word's new state */
+	State pass(const QByteArray &text, qint64 now);
+	State fail(const QByteArray &text, qint64 now);
+	inline void set(const QByteArray &text, const State &state) { _states.insert(text, state); }
+
+	/* One word per line: due time, interval and text, separated by tabs */
+	bool read(const QString &file);
+	bool write(QIODevice *out) const;
+
+private:
+	QHash<QByteArray, State> _states;
+};
+
+#endif
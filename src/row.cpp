@@ -16,111 +16,157 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <QList>
+#include "col.h"
+#include "perf.h"
 #include "row.h"
 #include "tile.h"
+#include "tilescene.h"
+#include "trace.h"
+
+Row::Row(TileScene *scene)
+	: _scene(scene)
+{
+}
 
 void Row::add(Tile *tile)
 {
-	connect(tile, SIGNAL(dropped(Tile*)),
-	        this, SLOT(checkRow(Tile*)));
-	connect(tile, SIGNAL(removed(Tile*)),
-	        this, SLOT(remove(Tile*)));
-	append(tile);
+	_tiles.append(tile);
 }
 
-void Row::destroyTiles()
+void Row::releaseTiles()
 {
-	QListIterator<Tile*> i(*this);
-	while (i.hasNext())
-		i.next()->deleteLater();
+	/* Each tile removes itself from us as it goes */
+	QVarLengthArray<Tile*, 8> tiles = _tiles;
+	for (int i = 0; i != tiles.size(); ++i)
+		_scene->releaseTile(tiles[i]);
 }
 
 void Row::bind()
 {
-	QListIterator<Tile*> i(*this);
-	while (i.hasNext())
-		i.next()->bind(this);
+	for (int i = 0; i != _tiles.size(); ++i)
+		_tiles[i]->bind(this);
 }
 
+/* Only rows made by checkRow() are ever bound */
 void Row::unbind()
 {
-	QListIterator<Tile*> i(*this);
-	while (i.hasNext())
-		i.next()->unbind();
-	delete this;
+	for (int i = 0; i != _tiles.size(); ++i)
+		_tiles[i]->unbind();
+	_scene->releaseRow(this);
+}
+
+/* The entry is let go, so that its deck can be freed */
+void Row::clear()
+{
+	_tiles.clear();
+	_entry = Bank::Entry();
 }
 
-void Row::makeDefault()
+void Row::makeDefault(const Bank::Entry &entry)
 {
-	QListIterator<Tile*> i(*this);
-	while (i.hasNext())
-		i.next()->makeDefault(this);
+	_entry = entry;
+	for (int i = 0; i != _tiles.size(); ++i)
+		_tiles[i]->makeDefault(this);
+}
+
+bool Row::matches(Tile *const *tiles) const
+{
+	if (_tiles.size() != _scene->colCount())
+		return false;
+	for (int i = 0; i != _tiles.size(); ++i)
+		if (_tiles[i]->text() != tiles[i]->text())
+			return false;
+	return true;
 }
 
 void Row::remove(Tile *tile)
 {
-	removeOne(tile);
-	if (isEmpty())
-		delete this;
+	int i = 0;
+	while (i != _tiles.size() && _tiles[i] != tile)
+		++i;
+	if (i == _tiles.size())
+		return;
+
+	for (; i != _tiles.size() - 1; ++i)
+		_tiles[i] = _tiles[i + 1];
+	_tiles.resize(_tiles.size() - 1);
+
+	if (_tiles.isEmpty())
+		_scene->releaseRow(this);
 }
 
 void Row::showCorrect()
 {
-	QListIterator<Tile*> i(*this);
-	while (i.hasNext())
-		i.next()->showCorrect();
+	for (int i = 0; i != _tiles.size(); ++i)
+		_tiles[i]->showCorrect();
 }
 
+/*
+ * A drop lines up the dropped tile with whatever is near it in the other
+ * columns. Each column finds its nearby tiles through its spatial index.
+ * For each combination of them (usually just one), the entries that could
+ * match are the default rows of the smallest group of tiles sharing a text
+ * among them, so the cost does not depend on the number of rows.
+ */
 void Row::checkRow(Tile *start)
 {
+	Perf::Timer timer(Perf::CheckRow);
+	Trace::Span span("Row::checkRow");
+	TileScene *scene = start->col()->scene();
 	Row *oldRow = start->row();
-	Row *row = new Row;
-	Tile *checked;
-	Tile *curColTile = start;
+	Row *row = NULL;
 	int y = start->y();
-
-	do {
-		Tile *tile;
-		QListIterator<Tile*> i(*this);
-		while (i.hasNext()) {
-			tile = i.next();
-			if (tile == curColTile)
-				row->append(start);
-			else if ((checked = tile->check(y)))
-				row->append(checked);
-			else
-				goto iter;
+	int count = scene->colCount();
+
+	QVarLengthArray<Tile*, 32> nearby;
+	QVarLengthArray<int, 16> first(count + 1);
+	QVarLengthArray<int, 16> pick(count);
+	QVarLengthArray<Tile*, 16> tiles(count);
+
+	for (int i = 0; i != count; ++i) {
+		first[i] = nearby.size();
+		pick[i] = 0;
+		if (i == start->col()->index())
+			nearby.append(start);
+		else
+			scene->col(i)->findNear(y, &nearby);
+		if (nearby.size() == first[i])
+			goto fail;
+	}
+	first[count] = nearby.size();
+
+	for (;;) {
+		const QList<Tile*> *dups = NULL;
+		for (int i = 0; i != count; ++i) {
+			tiles[i] = nearby[first[i] + pick[i]];
+			const QList<Tile*> &group = scene->col(i)->dups(tiles[i]->text());
+			if (!dups || group.size() < dups->size())
+				dups = &group;
 		}
 
-		row->bind();
-		goto sig;
+		foreach (Tile *dup, *dups) {
+			Row *entry = dup->defaultRow();
+			if (entry && entry->matches(tiles.constData())) {
+				row = scene->takeRow();
+				for (int i = 0; i != count; ++i)
+					row->_tiles.append(tiles[i]);
+				row->bind();
+				goto done;
+			}
+		}
 
-	iter:
-		row->clear();
-	} while ((curColTile = curColTile->dup()) && curColTile != start);
+		int i = 0;
+		while (i != count && ++pick[i] == first[i + 1] - first[i])
+			pick[i++] = 0;
+		if (i == count)
+			break;
+	}
 
-	delete row;
-	row = NULL;
+fail:
 	if (start->row())
 		start->row()->unbind();
 
-sig:
+done:
 	if (row != oldRow)
-		emit newRow(row);
-}
-
-QString Row::entry() const
-{
-	QString result;
-	QListIterator<Tile*> i(*this);
-	while (i.hasNext())
-		result += i.next()->text() + '\t';
-	result.chop(1);
-	return result;
-}
-
-QDataStream &operator<<(QDataStream &stream, const Row *row)
-{
-	return stream << row->entry();
+		scene->onBind(row);
 }
@@ -19,30 +19,43 @@
 #ifndef ROW_H
 #define ROW_H
 
-#include <QObject>
+#include "bank.h"
+#include <QVarLengthArray>
 
 class Tile;
-template<class T> class QList;
+class TileScene;
 
-class Row : public QObject, private QList<Tile*> {
-	Q_OBJECT
+/*
+ * Rows are plain classes, not QObjects, so they cannot emit signals;
+ * checkRow() tells the scene about a new binding by calling
+ * TileScene::onBind() itself. Rows come from the scene's pool, and go
+ * back there when they are unbound or, for the entries of a round, when
+ * their last tile is removed.
+ */
+class Row {
 public:
+	Row(TileScene *scene);
+
 	void add(Tile*);
-	void destroyTiles();
-	void makeDefault();
+	void releaseTiles();
+	void makeDefault(const Bank::Entry &entry);
 	void bind();
 	void unbind();
 	void showCorrect();
-	QString entry() const;
-
-signals:
-	void newRow(Row*);
+	void clear();
+	inline const Bank::Entry &entry() const { return _entry; }
+	void remove(Tile*);
+	/* Whether the tiles, one for each column, have the same text as ours */
+	bool matches(Tile *const *tiles) const;
 
-public slots:
 	void checkRow(Tile*);
-	void remove(Tile*);
-};
 
-QDataStream &operator<<(QDataStream&, const Row*);
+private:
+	TileScene *_scene;
+	/* Storage is kept when the row is cleared, so a pooled row does not
+	 * allocate again when it is reused */
+	QVarLengthArray<Tile*, 8> _tiles;
+	Bank::Entry _entry;
+};
 
 #endif
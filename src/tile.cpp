@@ -16,53 +16,74 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <QBrush>
+#include "col.h"
+#include <QApplication>
+#include <QFontMetricsF>
+#include <qmath.h>
+#include <QPainter>
+#include <QPixmapCache>
 #include "row.h"
 #include "tile.h"
+#include "tileitem.h"
 
-Tile::Tile(const QString &text, Tile *dup)
-	: QGraphicsSimpleTextItem(text)
+int Tile::_cacheLimit = 0;
+
+/* Measured as QGraphicsSimpleTextItem would, so tiles keep their size */
+static QSizeF measure(const QString &text)
+{
+	static QFontMetricsF metrics(Tile::font());
+	return metrics.size(0, text);
+}
+
+Tile::Tile(const QString &text, Col *col)
+	: _text(text)
+	, _size(measure(text))
+	, _item(NULL)
 	, _defaultRow(NULL)
 	, _row(NULL)
+	, _col(col)
+	, _band(NoBand)
+	, _index(-1)
+	, _dupIndex(-1)
+	, _slot(0)
 	, _movable(false)
 	, _green(false)
+	, _cacheScale(0)
 {
-	if (dup) {
-		_dup = dup->_dup ? dup->_dup : dup;
-		dup->_dup = this;
-	} else
-		_dup = NULL;
 }
 
-void Tile::deleteLater()
+void Tile::recycle(const QString &text)
 {
-	if (_dup) {
-		Tile *e = this;
-		while (e->_dup != this)
-			e = e->_dup;
-		e->_dup = _dup;
-	}
-
-	emit removed(this);
-	QObject::deleteLater();
+	_text = text;
+	_size = measure(text);
+	_defaultRow = NULL;
+	_row = NULL;
+	_band = NoBand;
+	_index = -1;
+	_dupIndex = -1;
+	_slot = 0;
+	_green = false;
+	_cacheKey.clear();
 }
 
-void Tile::mouseReleaseEvent(QGraphicsSceneMouseEvent *ev)
+const QFont &Tile::font()
 {
-	emit dropped(this);
-	QGraphicsItem::mouseReleaseEvent(ev);
+	static QFont font = QApplication::font();
+	return font;
 }
 
-Tile *Tile::check(int y)
+void Tile::setPos(const QPointF &pos)
 {
-	Tile *tile = this;
-
-	do {
-		if (tile->y() > y - 10 && tile->y() < y + 5 && !tile->_green)
-			return tile;
-	} while ((tile = tile->_dup) && tile != this);
+	QPointF from = _pos;
+	_pos = pos;
+	if (_item)
+		_item->setPos(pos);
+	_col->moveTile(this, from);
+}
 
-	return NULL;
+QColor Tile::color() const
+{
+	return _green ? QColor(0, 255, 0, 85) : QColor(Qt::black);
 }
 
 void Tile::unbind()
@@ -86,18 +107,72 @@ void Tile::bind(Row *row)
 
 void Tile::showCorrect(bool shown)
 {
-	static const QBrush green = QBrush(QColor(0, 255, 0, 85));
-
 	if (shown != _green) {
-		setBrush(shown ? green : Qt::black);
-		setFlag(QGraphicsItem::ItemIsMovable, !shown);
 		_green = shown;
-		update();
+		_cacheKey.clear();
+		if (_item)
+			_item->sync();
+		_col->updateTile(this);
 	}
 }
 
 void Tile::setMovable(bool movable)
 {
-	setFlag(QGraphicsItem::ItemIsMovable, movable && !_green);
 	_movable = movable;
+	if (_item)
+		_item->sync();
+}
+
+void Tile::setCacheLimit(int kb)
+{
+	_cacheLimit = kb;
+	if (kb)
+		QPixmapCache::setCacheLimit(kb);
+	else
+		QPixmapCache::clear();
+}
+
+bool Tile::drawCached(QPainter *painter, const QPointF &pos) const
+{
+	qreal scale = painter->deviceTransform().m11();
+	if (!_cacheLimit || scale <= 0)
+		return false;
+
+	QColor color = this->color();
+	if (_cacheKey.isEmpty() || scale != _cacheScale) {
+		_cacheScale = scale;
+		_cacheKey = "tile " + QString::number(color.rgba(), 16) + ' '
+			+ QString::number(scale, 'g', 4) + ' ' + _text;
+	}
+
+	QPixmap pixmap;
+	if (!QPixmapCache::find(_cacheKey, &pixmap)) {
+		pixmap = QPixmap(qCeil(_size.width() * scale), qCeil(_size.height() * scale));
+		if (pixmap.isNull())
+			return false;
+
+		pixmap.fill(Qt::transparent);
+		QPainter p(&pixmap);
+		p.scale(scale, scale);
+		p.setFont(font());
+		p.setPen(color);
+		p.drawText(QRectF(QPointF(), _size), Qt::AlignLeft | Qt::AlignTop, _text);
+		p.end();
+
+		QPixmapCache::insert(_cacheKey, pixmap);
+	}
+
+	painter->drawPixmap(QRectF(pos, QSizeF(pixmap.width() / scale, pixmap.height() / scale)),
+	                    pixmap, pixmap.rect());
+	return true;
+}
+
+void Tile::draw(QPainter *painter, const QPointF &pos) const
+{
+	if (drawCached(painter, pos))
+		return;
+
+	painter->setFont(font());
+	painter->setPen(color());
+	painter->drawText(QRectF(pos, _size), Qt::AlignLeft | Qt::AlignTop, _text);
 }
@@ -19,22 +19,51 @@
 #ifndef TILE_H
 #define TILE_H
 
-#include <QGraphicsSimpleTextItem>
+#include <QColor>
+#include <QPointF>
+#include <QRectF>
+#include <QString>
 
-class Tile;
+class Col;
+class QFont;
+class QPainter;
 class Row;
+class TileItem;
 
-class Tile : public QObject, public QGraphicsSimpleTextItem {
-	Q_OBJECT
+/*
+ * Tiles are plain records of a word on the board and where it is. They are
+ * shown by a TileItem, or drawn by their column's ColItem in batched mode;
+ * in virtualized mode only the tiles near the view have an item at all.
+ * Drops and removals are passed on by the scene. See TileScene::dropTile()
+ * and TileScene::releaseTile().
+ */
+class Tile {
 public:
-	Tile(const QString &text, Tile *dup);
-	void deleteLater();
+	Tile(const QString &text, Col *col);
+	/* Makes a tile that has left the board ready to be added again */
+	void recycle(const QString &text);
 
+	inline const QString &text() const { return _text; }
 	inline bool isCorrect() const { return _row; }
 	inline bool isShownCorrect() const { return _green; }
+	inline bool isMovable() const { return _movable && !_green; }
 	inline Row *defaultRow() const { return _defaultRow; }
 	inline Row *row() const { return _row; }
-	inline Tile *dup() const { return _dup; }
+	inline Col *col() const { return _col; }
+
+	inline QPointF pos() const { return _pos; }
+	inline qreal x() const { return _pos.x(); }
+	inline qreal y() const { return _pos.y(); }
+	inline QSizeF size() const { return _size; }
+	inline QRectF rect() const { return QRectF(_pos, _size); }
+	/* Moves the item too, if there is one, and tells the column */
+	void setPos(const QPointF &pos);
+	inline void setPos(qreal x, qreal y) { setPos(QPointF(x, y)); }
+	QColor color() const;
+
+	/* The item showing us, if any; see TileScene::takeItem() */
+	inline TileItem *item() const { return _item; }
+	inline void setItem(TileItem *item) { _item = item; }
 
 	/* We don't call this ourselves; the TileScene tells us to show correct */
 	void showCorrect(bool shown = true);
@@ -42,25 +71,60 @@ public:
 	void bind(Row*);
 	void unbind();
 
-	Tile *check(int y);
-
 	inline void makeDefault(Row *row) { _defaultRow = row; }
 
+	/* Position in the column's spatial index, or NoBand if not indexed */
+	enum { NoBand = -0x7fffffff };
+	inline int band() const { return _band; }
+	inline void setBand(int band) { _band = band; }
+
+	/* Position in the column, and the y it is laid out at */
+	inline int index() const { return _index; }
+	inline void setIndex(int index) { _index = index; }
+	inline qreal slot() const { return _slot; }
+	inline void setSlot(qreal slot) { _slot = slot; }
+	/* Position in the column's group of tiles with the same text */
+	inline int dupIndex() const { return _dupIndex; }
+	inline void setDupIndex(int index) { _dupIndex = index; }
+
 	static bool lessThan(Tile *a, Tile *b) { return a->text() < b->text(); }
 
-signals:
-	void dropped(Tile*);
-	void removed(Tile*);
+	/* All tiles are drawn in the application's font */
+	static const QFont &font();
 
-protected:
-	void mouseReleaseEvent(QGraphicsSceneMouseEvent*);
+	/*
+	 * Tiles are rasterized once per text, color and scale into the shared
+	 * QPixmapCache and blitted from there. The scale is the painter's
+	 * device scale, so it follows the view's zoom and, on Qt 5, the
+	 * screen's pixel ratio. The limit is in kilobytes and applies to the
+	 * whole cache; 0 turns caching off and draws the text directly.
+	 */
+	static void setCacheLimit(int kb);
+	/* Draws the tile at pos from the cache; false if caching is off */
+	bool drawCached(QPainter *painter, const QPointF &pos) const;
+	/* Draws the tile at pos, from the cache if it is on */
+	void draw(QPainter *painter, const QPointF &pos) const;
 
 private:
+	QString _text;
+	QPointF _pos;
+	QSizeF _size;
+	TileItem *_item;
 	Row *_defaultRow;
 	Row *_row;
-	Tile *_dup;
+	Col *_col;
+	int _band;
+	int _index;
+	int _dupIndex;
+	qreal _slot;
 	bool _movable;
 	bool _green;
+	/* Our key into the cache, made again when the scale it was made for
+	 * changes, or emptied when the text or color does */
+	mutable QString _cacheKey;
+	mutable qreal _cacheScale;
+
+	static int _cacheLimit;
 };
 
 #endif
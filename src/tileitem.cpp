@@ -0,0 +1,69 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "col.h"
+#include <QGraphicsSceneMouseEvent>
+#include "tile.h"
+#include "tileitem.h"
+#include "tilescene.h"
+
+TileItem::TileItem()
+	: _tile(NULL)
+{
+	setFlag(QGraphicsItem::ItemSendsGeometryChanges);
+}
+
+void TileItem::setTile(Tile *tile)
+{
+	prepareGeometryChange();
+	_tile = tile;
+	if (tile) {
+		setPos(tile->pos());
+		sync();
+	}
+}
+
+void TileItem::sync()
+{
+	setFlag(QGraphicsItem::ItemIsMovable, _tile->isMovable());
+	update();
+}
+
+QRectF TileItem::boundingRect() const
+{
+	return _tile ? QRectF(QPointF(), _tile->size()) : QRectF();
+}
+
+void TileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem*, QWidget*)
+{
+	_tile->draw(painter, QPointF());
+}
+
+void TileItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *ev)
+{
+	_tile->col()->scene()->dropTile(_tile);
+	QGraphicsItem::mouseReleaseEvent(ev);
+}
+
+/* Dragging moves the item first; the tile follows */
+QVariant TileItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+	if (change == ItemPositionHasChanged && _tile && _tile->pos() != pos())
+		_tile->setPos(pos());
+	return QGraphicsItem::itemChange(change, value);
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILEITEM_H
+#define TILEITEM_H
+
+#include <QGraphicsItem>
+
+class Tile;
+
+/*
+ * Shows a Tile in the scene and lets it be dragged. Items come from the
+ * scene's pool and are handed from tile to tile; see TileScene::takeItem().
+ */
+class TileItem : public QGraphicsItem {
+public:
+	enum { Type = UserType + 1 };
+
+	TileItem();
+
+	inline Tile *tile() const { return _tile; }
+	/* Shows tile, or nothing if it is NULL */
+	void setTile(Tile *tile);
+	/* Takes up the tile's color and whether it can be moved */
+	void sync();
+
+	int type() const { return Type; }
+	QRectF boundingRect() const;
+	void paint(QPainter*, const QStyleOptionGraphicsItem*, QWidget*);
+
+protected:
+	void mouseReleaseEvent(QGraphicsSceneMouseEvent*);
+	QVariant itemChange(GraphicsItemChange, const QVariant&);
+
+private:
+	Tile *_tile;
+};
+
+#endif
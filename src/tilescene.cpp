@@ -17,16 +17,31 @@
  */
 
 #include "col.h"
+#include "gzipwriter.h"
 #include "mainwindow.h"
+#include "perf.h"
 #include <QApplication>
+#include <QDateTime>
 #include <QDir>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QGraphicsSceneWheelEvent>
+#include <QGraphicsView>
 #include <QMessageBox>
-#include <QTextStream>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
+#include <QTemporaryFile>
+#include "replacefile.h"
 #include "row.h"
 #include "tile.h"
+#include "tileitem.h"
 #include "tilescene.h"
+#include "trace.h"
+
+/* Journal events after which the state file is rewritten */
+static const int CompactEvents = 1024;
+/* How often the state file is rewritten if anything has changed */
+static const int AutosaveInterval = 5 * 60 * 1000;
 
 TileScene::TileScene(QObject *parent)
 	: QGraphicsScene(parent)
@@ -35,24 +50,118 @@ TileScene::TileScene(QObject *parent)
 	, _curRowCount(0)
 	, _correctCount(0)
 	, _placeMode(AutoCheck)
+	, _batched(false)
+	, _virtualized(false)
+	, _updateDepth(0)
+	, _indexMethod(BspTreeIndex)
+	, _lowLatencyDrag(false)
+	, _dragging(NULL)
+	, _rowAllocations(0)
+	, _itemAllocations(0)
+	, _itemsInUse(0)
+	, _seed(QDateTime::currentMSecsSinceEpoch())
+	, _actionDepth(0)
 {
+	setTileCacheSmall();
+	_bank.setSeed(_seed);
+
 	connect(qApp, SIGNAL(lastWindowClosed()),
-	        this, SLOT(dumpState()));
+	        this, SLOT(finish()));
+	connect(&_loader, SIGNAL(progressValueChanged(int)),
+	        this, SLOT(onLoadProgress(int)));
+	connect(&_loader, SIGNAL(finished()),
+	        this, SLOT(onLoaded()));
+	connect(&_saver, SIGNAL(finished()),
+	        this, SLOT(onSaved()));
+	connect(&_exporter, SIGNAL(finished()),
+	        this, SLOT(onExported()));
+	connect(&_autosave, SIGNAL(timeout()),
+	        this, SLOT(autosave()));
+	_autosave.start(AutosaveInterval);
+}
+
+/* Everything goes back to the pools first, so it is freed with them */
+TileScene::~TileScene()
+{
+	foreach (Col *col, _cols)
+		col->clear();
+	reapTiles();
+	qDeleteAll(_cols);
+	qDeleteAll(_freeRows);
+	qDeleteAll(_freeItems);
 }
 
 void TileScene::init()
 {
 	setColCount(2);
-	connect(_cols.at(0), SIGNAL(itemCountChanged(int)),
-	        this, SLOT(setRowCount(int)));
 	fillState(false);
 }
 
+TileScene::Action::Action(TileScene *scene, const char *name)
+	: _scene(scene)
+	, _recorded(!scene->_actionDepth++ && scene->_recording.isRecording())
+{
+	if (name && _recorded)
+		record(name);
+}
+
+TileScene::Action::~Action()
+{
+	--_scene->_actionDepth;
+}
+
+void TileScene::Action::record(const QByteArray &action)
+{
+	_scene->_recording.append(action);
+}
+
+void TileScene::setSeed(quint64 seed)
+{
+	_seed = seed;
+	_bank.setSeed(seed);
+	for (int i = 0; i != _cols.size(); ++i)
+		_cols.at(i)->setSeed(seed + i + 1);
+}
+
 void TileScene::setRowCount(int v)
 {
 	_curRowCount = v;
 }
 
+void TileScene::setRoundSize(int rows)
+{
+	_rowCount = rows;
+	if (!_journal.setRowCount(rows))
+		journalError();
+}
+
+void TileScene::waitForDump()
+{
+	_exporter.waitForFinished();
+}
+
+void TileScene::beginUpdate()
+{
+	if (_updateDepth++)
+		return;
+
+	_indexMethod = itemIndexMethod();
+	setItemIndexMethod(NoIndex);
+	foreach (QGraphicsView *view, views())
+		view->viewport()->setUpdatesEnabled(false);
+}
+
+void TileScene::endUpdate()
+{
+	if (--_updateDepth)
+		return;
+
+	setItemIndexMethod(_indexMethod);
+	foreach (QGraphicsView *view, views())
+		view->viewport()->setUpdatesEnabled(true);
+	update();
+}
+
 void TileScene::updateCounts()
 {
 	if (_correctCount == _curRowCount)
@@ -76,7 +185,7 @@ void TileScene::shiftCorrectCount(int delta)
 void TileScene::quitNow()
 {
 	disconnect(qApp, SIGNAL(lastWindowClosed()),
-	        this, SLOT(dumpState()));
+	        this, SLOT(finish()));
 	qApp->closeAllWindows();
 }
 
@@ -85,116 +194,534 @@ QString TileScene::stateFile() const
 	return QDir::homePath() + "/.config/inquest.state";
 }
 
+QString TileScene::journalFile() const
+{
+	return QDir::homePath() + "/.config/inquest.journal";
+}
+
+QString TileScene::reviewsFile() const
+{
+	return QDir::homePath() + "/.config/inquest.reviews";
+}
+
 void TileScene::fill()
 {
-	QStringList files = QFileDialog::getOpenFileNames(MainWindow::instance, QString(), QString(), "Tab-separated values (*.tsv);;All Files (*)");
-	if (!files.isEmpty()) {
-		foreach (QString file, files)
-			if (!fill(file))
-				return;
+	QStringList files = QFileDialog::getOpenFileNames(MainWindow::instance, QString(), QString(), "Tab-separated values (*.tsv *.tsv.gz);;Compiled decks (*.deck);;All Files (*)");
+	if (!files.isEmpty())
+		fill(files);
+}
 
-		advance();
-	}
+/*
+ * Load several decks at once on the thread pool. They are merged into a
+ * single bank once all of them have been read; see onLoaded().
+ */
+void TileScene::fill(const QStringList &files)
+{
+	Trace::Span span("TileScene::fill");
+	if (_loader.isRunning())
+		return;
+
+	_loadTimer.start();
+	_loading = files;
+	_loader.setFuture(QtConcurrent::mapped(_loading, loadDeck));
+	emit loadProgress(0, files.size());
 }
 
-void TileScene::fillState(bool error)
+TileScene::Loaded TileScene::loadDeck(const QString &file)
 {
-	if (fill(stateFile(), error))
-		advance();
+	Trace::Span span("Deck::load");
+	Loaded result;
+	result.deck = Bank::DeckRef(Deck::load(file, &result.error, true));
+	return result;
 }
 
-bool TileScene::fill(const QString &file, bool showError)
+void TileScene::onLoadProgress(int done)
 {
-	QFile store(file);
-	if (!store.open(QFile::ReadOnly)) {
-		if (showError)
-			QMessageBox::critical(MainWindow::instance, "Error reading file", store.errorString());
-		return false;
+	emit loadProgress(done, _loading.size());
+}
+
+void TileScene::onLoaded()
+{
+	Trace::Span span("TileScene::onLoaded");
+	QFuture<Loaded> future = _loader.future();
+	QList<Bank::DeckRef> decks;
+	int columns = 0;
+	QString first;
+
+	for (int i = 0; i != future.resultCount(); ++i) {
+		Loaded result = future.resultAt(i);
+		QString error = result.error;
+
+		if (result.deck) {
+			if (!columns) {
+				columns = result.deck->columns();
+				first = _loading.at(i);
+			} else if (result.deck->columns() != columns)
+				error = QString("File '%1' has %2 columns, but '%3' has %4.")
+					.arg(_loading.at(i)).arg(result.deck->columns())
+					.arg(first).arg(columns);
+		}
+
+		if (!error.isEmpty()) {
+			updateCounts();
+			QMessageBox::critical(MainWindow::instance, "Error reading file", error);
+			return;
+		}
+
+		decks.append(result.deck);
 	}
 
+	stopRecording();
+	discardBoard();
 	_bank.clear();
-	QTextStream in(&store);
+	foreach (const Bank::DeckRef &deck, decks)
+		_bank.add(deck.data());
+	setColCount(columns);
+	advance();
+	trimPools();
+	compact();
+	Perf::record(Perf::Fill, _loadTimer.nsecsElapsed());
+}
+
+/* The state file is the last snapshot; the journal has what was done since */
+void TileScene::fillState(bool error)
+{
+	waitForSave();
+	stopRecording();
+
+	/* Reviews first, so the bank is built with the right due times */
+	QHash<QByteArray, int> done;
+	_reviews = Reviews();
+	_reviews.read(reviewsFile());
+	bool replay = Journal::read(journalFile(), stateFile(), &done, &_rowCount, &_reviews);
 
-	QString line = in.readLine();
+	if (!fill(stateFile(), error))
+		return;
+
+	if (replay) {
+		_bank.remove(&done);
+		if (!_journal.open(journalFile()))
+			journalError();
+	} else if (!_journal.reset(journalFile(), stateFile(), _rowCount))
+		journalError();
+
+	advance();
+	trimPools();
+}
 
-	int count = line.count('\t');
-	if (count < 1) {
+/* Usually the state file, which compact() replaces while the bank still
+ * uses it, so it is read rather than mapped */
+bool TileScene::fill(const QString &file, bool showError)
+{
+	Perf::Timer timer(Perf::Fill);
+	Trace::Span span("TileScene::fill");
+	QString error;
+	Deck *deck = Deck::read(file, &error);
+	if (!deck) {
 		if (showError)
-			QMessageBox::critical(MainWindow::instance, "Error reading file", "File '" + file + "' does not look like a tab-separated value file.");
+			QMessageBox::critical(MainWindow::instance, "Error reading file", error);
 		return false;
 	}
 
-	do {
-		if (line.count('\t') >= count)
-			_bank.append(line);
-		line = in.readLine();
-	} while (!in.atEnd());
-
-	store.close();
+	discardBoard();
+	_bank.clear();
+	_bank.add(deck);
 
-	setColCount(count + 1);
+	setColCount(deck->columns());
 
 	return true;
 }
 
 void TileScene::dump()
 {
-	QString file = QFileDialog::getSaveFileName(MainWindow::instance, QString(), QString(), "Tab-separated values (*.tsv)");
+	QString file = QFileDialog::getSaveFileName(MainWindow::instance, QString(), QString(), "Tab-separated values (*.tsv);;Compressed tab-separated values (*.tsv.gz)");
 	if (!file.isEmpty())
 		dump(file);
 }
 
 void TileScene::dumpState()
 {
-	if (_bank.isEmpty() && !_curRowCount)
+	compact();
+}
+
+/* On the way out, the words finished on the board are left out of the
+ * snapshot, unless they are scheduled to come back, and the journal is no
+ * longer needed. This save is the only one made on the GUI thread. */
+void TileScene::finish()
+{
+	waitForSave();
+	_exporter.waitForFinished();
+
+	_journal.close();
+	if (_bank.isEmpty() && !_curRowCount) {
 		QFile::remove(stateFile());
-	else
-		dump(stateFile());
+		QFile::remove(journalFile());
+	} else {
+		Saved saved = save(snapshot(stateFile(), _bank.isScheduled()));
+		if (saved.error.isEmpty())
+			QFile::remove(journalFile());
+		else
+			QMessageBox::critical(MainWindow::instance, "Error writing file", saved.error);
+	}
 }
 
 void TileScene::dump(const QString &file)
 {
-	QFile store(file);
-	if (!store.open(QFile::WriteOnly))
-		QMessageBox::critical(MainWindow::instance, "Error writing file", store.errorString());
+	Trace::Span span("TileScene::dump");
+	_exporter.waitForFinished();
+	_exporter.setFuture(QtConcurrent::run(save, snapshot(file, false)));
+}
+
+void TileScene::onExported()
+{
+	if (_exporter.isRunning())
+		return;
 
-	QTextStream out(&store);
+	Saved saved = _exporter.result();
+	if (!saved.error.isEmpty())
+		QMessageBox::critical(MainWindow::instance, "Error writing file", saved.error);
+}
+
+void TileScene::record()
+{
+	QString file = QFileDialog::getSaveFileName(MainWindow::instance, QString(), QString(), "Recordings (*.inqr)");
+	QString error;
+	if (!file.isEmpty() && !startRecording(file, &error))
+		QMessageBox::critical(MainWindow::instance, "Error writing file", error);
+}
 
-	foreach(const QString entry, _bank)
-		out << entry << '\n';
-	foreach(Tile *tile, *_cols.at(0)->tiles())
+/*
+ * The rows on the board that are not finished are put back, as skip()
+ * would but without failing their reviews, and the words are saved before
+ * the first round is drawn with a new seed. The words are saved as one
+ * deck without their due times, so a session drawn by due time, or by
+ * weight from more than one deck, would not play back the same and is
+ * not recorded.
+ */
+bool TileScene::startRecording(const QString &file, QString *error)
+{
+	stopRecording();
+
+	if (_bank.isScheduled() || (_bank.isWeighted() && _bank.deckCount() > 1)) {
+		*error = "Only sessions drawn at random, or by weight from a single deck, can be recorded.";
+		return false;
+	}
+
+	Recording::Setup setup;
+	setup.seed = QDateTime::currentMSecsSinceEpoch();
+	setup.rows = _rowCount;
+	setup.placement = _placeMode;
+	setup.weighted = _bank.isWeighted();
+	foreach (Col *col, _cols)
+		setup.layouts.append(col->layoutMode());
+
+	beginUpdate();
+	foreach (Tile *tile, *_cols.at(0)->tiles())
 		if (!tile->isShownCorrect())
-			out << tile->defaultRow()->entry() << '\n';
+			_bank.put(tile->defaultRow()->entry());
+	clearBoard();
+
+	*error = save(snapshot(Recording::wordsFile(file), false)).error;
+	setSeed(setup.seed);
+	advance();
+	endUpdate();
 
-	store.close();
+	if (!error->isEmpty())
+		return false;
+	if (!_recording.start(file, setup)) {
+		*error = "Could not write '" + file + "'.";
+		return false;
+	}
+	return true;
+}
+
+void TileScene::stopRecording()
+{
+	_recording.stop();
+}
+
+int TileScene::replay(const QString &file, QString *error)
+{
+	Recording::Setup setup;
+	QList<QByteArray> actions;
+	if (!Recording::read(file, &setup, &actions)) {
+		*error = "File '" + file + "' is not a recording.";
+		return -1;
+	}
+
+	Deck *deck = Deck::load(Recording::wordsFile(file), error);
+	if (!deck)
+		return -1;
+
+	_bank.clear();
+	_bank.setWeighted(setup.weighted);
+	_bank.add(deck);
+	setColCount(deck->columns());
+
+	_rowCount = setup.rows;
+	_placeMode = PlacementMode(setup.placement);
+	for (int i = 0; i < setup.layouts.size() && i < _colCount; ++i)
+		_cols.at(i)->setLayoutMode(Col::LayoutMode(setup.layouts.at(i)));
+
+	setSeed(setup.seed);
+	advance();
+	trimPools();
+
+	foreach (const QByteArray &action, actions) {
+		if (!play(action)) {
+			*error = "Recording '" + file + "' has an action that cannot be played: " + action;
+			return -1;
+		}
+		reapTiles();
+	}
+
+	return actions.size();
+}
+
+bool TileScene::play(const QByteArray &action)
+{
+	QList<QByteArray> args = action.split(' ');
+	const QByteArray &name = args.at(0);
+
+	if (name == "drop" && args.size() == 5) {
+		int c = args.at(1).toInt();
+		int i = args.at(2).toInt();
+		if (c < 0 || c >= _colCount || i < 0 || i >= _cols.at(c)->tiles()->size())
+			return false;
+		Tile *tile = _cols.at(c)->tiles()->at(i);
+		tile->setPos(args.at(3).toDouble(), args.at(4).toDouble());
+		dropTile(tile);
+	} else if (name == "sort" && args.size() == 2) {
+		int c = args.at(1).toInt();
+		if (c < 0 || c >= _colCount)
+			return false;
+		_cols.at(c)->setSorted();
+	} else if (name == "shuffle" && args.size() == 2) {
+		int c = args.at(1).toInt();
+		if (c < 0 || c >= _colCount)
+			return false;
+		_cols.at(c)->setShuffled();
+	} else if (name == "placement" && args.size() == 2)
+		setPlacement(PlacementMode(args.at(1).toInt()));
+	else if (name == "layout")
+		layout();
+	else if (name == "reset")
+		reset();
+	else if (name == "skip")
+		skip();
+	else if (name == "check")
+		checkAdvance();
+	else if (name == "add")
+		addOne();
+	else if (name == "remove")
+		removeOne();
+	else
+		return false;
+
+	return true;
+}
+
+/* The bank and the rows on the board, including the ones shown correct if
+ * shown is true. Taking it copies no entries. */
+TileScene::Snapshot TileScene::snapshot(const QString &file, bool shown) const
+{
+	Snapshot result;
+	result.file = file;
+	result.compress = file == stateFile() || file.endsWith(".gz");
+	result.bank = _bank;
+	if (file == stateFile()) {
+		result.reviewsFile = reviewsFile();
+		result.reviews = _reviews;
+	}
+	if (!_cols.isEmpty())
+		foreach (Tile *tile, *_cols.at(0)->tiles())
+			if (shown || !tile->isShownCorrect())
+				result.rows.append(tile->defaultRow()->entry());
+	return result;
+}
+
+/*
+ * Runs on the thread pool. Files are written under another name and
+ * renamed over the old ones, so they are never seen half written, and a
+ * deck that still maps the old one keeps reading it.
+ */
+TileScene::Saved TileScene::save(const Snapshot &snapshot)
+{
+	Trace::Span span("TileScene::save");
+	Saved result;
+	result.file = snapshot.file;
+
+	QDir().mkpath(QFileInfo(snapshot.file).path());
+
+	if (!snapshot.reviewsFile.isEmpty()) {
+		QTemporaryFile store(snapshot.reviewsFile + ".XXXXXX");
+		if (!store.open() || !snapshot.reviews.write(&store) || !store.flush()) {
+			result.error = store.errorString();
+			return result;
+		}
+		if (!replaceFile(&store, snapshot.reviewsFile, &result.error))
+			return result;
+	}
+
+	QTemporaryFile store(snapshot.file + ".XXXXXX");
+	if (!store.open()) {
+		result.error = store.errorString();
+		return result;
+	}
+
+	QByteArray rows;
+	foreach (const Bank::Entry &entry, snapshot.rows) {
+		rows += entry.text();
+		rows += '\n';
+	}
+
+	GzipWriter gzip(&store);
+	QIODevice *out = &store;
+	if (snapshot.compress) {
+		gzip.open(QIODevice::WriteOnly);
+		out = &gzip;
+	}
+
+	bool written = snapshot.bank.write(out) && out->write(rows) == rows.size();
+	gzip.close();
+	if (!written || gzip.failed() || !store.flush()) {
+		result.error = out->errorString();
+		return result;
+	}
+
+	replaceFile(&store, snapshot.file, &result.error);
+	return result;
+}
+
+/*
+ * Start a new snapshot on the thread pool. Everything on the board goes
+ * into it, since the words finished there are journaled only when they
+ * leave the board. Events journaled while it is written are carried over
+ * into the new journal.
+ */
+void TileScene::compact()
+{
+	waitForSave();
+
+	if (_bank.isEmpty() && !_curRowCount) {
+		_journal.close();
+		QFile::remove(stateFile());
+		QFile::remove(journalFile());
+		return;
+	}
+
+	_journal.mark();
+	_saver.setFuture(QtConcurrent::run(save, snapshot(stateFile(), true)));
+}
+
+void TileScene::onSaved()
+{
+	/* Already handled by waitForSave() */
+	if (!_journal.isMarked() || _saver.isRunning())
+		return;
+
+	Saved saved = _saver.result();
+	if (saved.error.isEmpty()) {
+		if (!_journal.reset(journalFile(), stateFile(), _rowCount))
+			journalError();
+	} else {
+		_journal.unmark();
+		QMessageBox::critical(MainWindow::instance, "Error writing file", saved.error);
+	}
+}
+
+/* The session goes on without a journal until the next snapshot, which
+ * resets it */
+void TileScene::journalError()
+{
+	QMessageBox::critical(MainWindow::instance, "Error writing file",
+		"Could not write '" + journalFile() + "': " + _journal.errorString());
+}
+
+void TileScene::waitForSave()
+{
+	if (_saver.isRunning()) {
+		_saver.waitForFinished();
+		onSaved();
+	}
+}
+
+void TileScene::autosave()
+{
+	if (_journal.size() && !_saver.isRunning())
+		compact();
+}
+
+void TileScene::checkCompact()
+{
+	if (_journal.size() >= CompactEvents && !_saver.isRunning())
+		compact();
+}
+
+/* In scheduled mode a finished word goes back to the bank until it is due */
+void TileScene::completed(Tile *tile)
+{
+	const Bank::Entry &entry = tile->defaultRow()->entry();
+
+	if (_bank.isScheduled()) {
+		qint64 now = QDateTime::currentDateTime().toTime_t();
+		Reviews::State state = _reviews.pass(entry.text(), now);
+		if (!_journal.review(entry.text(), state))
+			journalError();
+		_bank.put(entry);
+	} else
+		if (!_journal.complete(entry.text()))
+			journalError();
 }
 
 void TileScene::advance()
 {
-	foreach (Col *col, _cols)
-		col->clear();
+	Perf::Timer timer(Perf::Advance);
+	Trace::Span span("TileScene::advance");
+	beginUpdate();
+	clearBoard();
 	add();
 	shiftCorrectCount(0);
 	layout();
+	endUpdate();
+	checkCompact();
+}
+
+/* The rows shown correct are finished; the rest are dropped. Every bound
+ * row has a tile in the first column, so unbinding through it returns them
+ * all to the pool before the tiles go. */
+void TileScene::clearBoard()
+{
+	foreach (Tile *tile, *_cols.at(0)->tiles())
+		if (tile->isShownCorrect())
+			completed(tile);
+
+	discardBoard();
 }
 
-Tile *TileScene::addTile(const QString &text, Col *col)
+/* Without finishing the words shown correct, for a board whose bank is
+ * being replaced: completed() would put them in the new bank and journal
+ * them against the new state */
+void TileScene::discardBoard()
 {
-	Tile *tile = col->addTile(text);
-	addItem(tile);
-	return tile;
+	if (_cols.isEmpty())
+		return;
+
+	_cols.at(0)->reset();
+	foreach (Col *col, _cols)
+		col->clear();
 }
 
 void TileScene::add()
 {
+	Trace::Span span("TileScene::add");
 	while (_curRowCount != _rowCount && !_bank.isEmpty()) {
-		QStringList entry = _bank.takeAt(rand() % _bank.size()).split('\t');
-		Row *row = new Row;
+		Bank::Entry entry = _bank.take();
+		QStringList fields = entry.fields();
+		Row *row = takeRow();
 		for (int i = 0; i != _colCount; ++i)
-			row->add(addTile(entry[i], _cols[i]));
-		row->makeDefault();
-		connect(row, SIGNAL(newRow(Row*)),
-		        this, SLOT(onBind(Row*)));
+			row->add(_cols[i]->addTile(fields.value(i)));
+		row->makeDefault(entry);
 	}
 
 	place();
@@ -203,11 +730,145 @@ void TileScene::add()
 void TileScene::removeTile(Tile *tile)
 {
 	bool correct = tile->isCorrect();
-	tile->defaultRow()->destroyTiles();
+	if (tile->isShownCorrect())
+		completed(tile);
+	tile->defaultRow()->releaseTiles();
 	if (correct)
 		shiftCorrectCount(-1);
 }
 
+Tile *TileScene::tileAt(const QPointF &pos) const
+{
+	foreach (Col *col, _cols)
+		if (col->visible())
+			if (Tile *tile = col->tileAt(pos))
+				return tile;
+	return NULL;
+}
+
+bool TileScene::beginDrag(Tile *tile)
+{
+	if (!_lowLatencyDrag || _dragging || !tile->isMovable())
+		return false;
+
+	_dragging = tile;
+	tile->col()->liftTile(tile);
+	return true;
+}
+
+void TileScene::endDrag()
+{
+	if (!_dragging)
+		return;
+
+	Tile *tile = _dragging;
+	_dragging = NULL;
+	tile->col()->settleTile(tile);
+}
+
+void TileScene::dropTile(Tile *tile)
+{
+	Action action(this);
+	if (action.isRecorded())
+		action.record("drop " + QByteArray::number(tile->col()->index())
+			+ ' ' + QByteArray::number(tile->index())
+			+ ' ' + QByteArray::number(tile->x(), 'g', 17)
+			+ ' ' + QByteArray::number(tile->y(), 'g', 17));
+	endDrag();
+	tile->defaultRow()->checkRow(tile);
+}
+
+void TileScene::releaseTile(Tile *tile)
+{
+	if (tile == _dragging)
+		endDrag();
+	tile->col()->removeTile(tile);
+	if (tile->item())
+		releaseItem(tile);
+	if (tile->row())
+		tile->row()->unbind();
+	if (tile->defaultRow())
+		tile->defaultRow()->remove(tile);
+
+	if (_deadTiles.isEmpty())
+		QMetaObject::invokeMethod(this, "reapTiles", Qt::QueuedConnection);
+	_deadTiles.append(tile);
+}
+
+/* Not at once, since a tile may be released while it handles an event */
+void TileScene::reapTiles()
+{
+	foreach (Tile *tile, _deadTiles)
+		tile->col()->recycleTile(tile);
+	_deadTiles.clear();
+}
+
+Row *TileScene::takeRow()
+{
+	if (_freeRows.isEmpty()) {
+		++_rowAllocations;
+		return new Row(this);
+	}
+
+	return _freeRows.takeLast();
+}
+
+void TileScene::releaseRow(Row *row)
+{
+	row->clear();
+	_freeRows.append(row);
+}
+
+void TileScene::takeItem(Tile *tile)
+{
+	TileItem *item;
+	if (_freeItems.isEmpty()) {
+		item = new TileItem;
+		++_itemAllocations;
+	} else
+		item = _freeItems.takeLast();
+	++_itemsInUse;
+
+	tile->setItem(item);
+	item->setTile(tile);
+	addItem(item);
+}
+
+void TileScene::releaseItem(Tile *tile)
+{
+	TileItem *item = tile->item();
+	removeItem(item);
+	item->setTile(NULL);
+	tile->setItem(NULL);
+	_freeItems.append(item);
+	--_itemsInUse;
+}
+
+/*
+ * A board keeps at most one round of tiles in each column's pool, as many
+ * rows as a round and its bindings use, and an item for each tile. The
+ * tiles released last are reaped first, so none are missed.
+ */
+void TileScene::trimPools()
+{
+	reapTiles();
+
+	foreach (Col *col, _cols)
+		col->trimTiles(_rowCount);
+	while (_freeRows.size() > 2 * _rowCount)
+		delete _freeRows.takeLast();
+	while (_freeItems.size() > _rowCount * _colCount)
+		delete _freeItems.takeLast();
+}
+
+int TileScene::tileAllocations() const
+{
+	int result = 0;
+	foreach (Col *col, _cols)
+		result += col->tileAllocations();
+	return result;
+}
+
 void TileScene::stripCorrect()
 {
 	if (!_correctCount)
@@ -222,21 +883,29 @@ void TileScene::stripCorrect()
 
 void TileScene::layout()
 {
+	Action action(this, "layout");
+	Perf::Timer timer(Perf::Layout);
+	Trace::Span span("TileScene::layout");
 	if (_correctCount == _curRowCount) {
 		reset();
 		return;
 	}
 
+	beginUpdate();
 	stripCorrect();
 
 	foreach (Col *col, _cols)
 		col->layout();
 
 	place();
+	endUpdate();
+	checkCompact();
 }
 
 void TileScene::place()
 {
+	Perf::Timer timer(Perf::Place);
+	Trace::Span span("TileScene::place");
 	qreal tileWidth = 0;
 	foreach (Col *group, _cols)
 		tileWidth += group->width();
@@ -254,16 +923,31 @@ void TileScene::place()
 
 void TileScene::reset()
 {
+	Action action(this, "reset");
+	beginUpdate();
 	_cols.at(0)->reset();
+	foreach (Col *col, _cols)
+		col->invalidate();
 	place();
+	endUpdate();
 	shiftCorrectCount(0);
 }
 
 void TileScene::skip()
 {
+	Action action(this, "skip");
+	qint64 now = QDateTime::currentDateTime().toTime_t();
+
 	foreach (Tile *tile, *_cols.at(0)->tiles())
-		if (!tile->isShownCorrect())
-			_bank.append(tile->defaultRow()->entry());
+		if (!tile->isShownCorrect()) {
+			const Bank::Entry &entry = tile->defaultRow()->entry();
+			if (_bank.isScheduled()) {
+				Reviews::State state = _reviews.fail(entry.text(), now);
+				if (!_journal.review(entry.text(), state))
+					journalError();
+			}
+			_bank.put(entry);
+		}
 	advance();
 }
 
@@ -278,6 +962,7 @@ void TileScene::onBind(Row *row)
 
 void TileScene::checkAdvance()
 {
+	Action action(this, "check");
 	if (_correctCount == _curRowCount)
 		advance();
 	else if (_placeMode != NoCheck)
@@ -286,28 +971,39 @@ void TileScene::checkAdvance()
 
 void TileScene::addOne()
 {
+	Action action(this, "add");
 	if (!_bank.isEmpty()) {
 		++_rowCount;
+		if (!_journal.setRowCount(_rowCount))
+			journalError();
 		add();
 	}
 }
 
 void TileScene::removeOne()
 {
+	Action action(this, "remove");
 	if (_curRowCount > 1) {
 		Tile *tile = _cols.at(0)->randTile();
 		if (!tile->isShownCorrect())
-			_bank.append(tile->defaultRow()->entry());
+			_bank.put(tile->defaultRow()->entry());
 		removeTile(tile);
 		_rowCount = _curRowCount;
+		if (!_journal.setRowCount(_rowCount))
+			journalError();
 		place();
+		checkCompact();
+		/* After the tile is reaped; it may be handling an event */
+		QMetaObject::invokeMethod(this, "trimPools", Qt::QueuedConnection);
 	}
 }
 
 void TileScene::reveal(bool show)
 {
+	beginUpdate();
 	foreach (Col *group, _cols)
 		group->reveal(show);
+	endUpdate();
 	updateCounts();
 }
 
@@ -316,6 +1012,8 @@ void TileScene::setColCount(int count)
 	if (count > _colCount)
 		for (int i = _colCount; i != count; ++i) {
 			Col *col = new Col(this, i, i ? Col::Shuffle : Col::Sort);
+			col->setBatched(_batched);
+			col->setSeed(_seed + i + 1);
 			connect(col, SIGNAL(layoutChanged()),
 			        this, SLOT(layout()));
 			_cols.append(col);
@@ -323,15 +1021,93 @@ void TileScene::setColCount(int count)
 		}
 	else if (count < _colCount)
 		for (int i = count; i != _colCount; ++i) {
-			delete _cols.takeLast();
+			Col *col = _cols.takeLast();
+			col->clear();
+			reapTiles();
+			delete col;
 			emit addRemoveGroup(NULL);
 		}
 
 	_colCount = count;
 }
 
+/* A recording is replayed in the draw mode it started with, so changing
+ * the mode ends it */
+void TileScene::setWeighted(bool weighted)
+{
+	if (weighted != _bank.isWeighted())
+		stopRecording();
+	_bank.setWeighted(weighted);
+}
+
+void TileScene::setScheduled(bool scheduled)
+{
+	if (scheduled != _bank.isScheduled())
+		stopRecording();
+	_bank.setSchedule(scheduled ? &_reviews : NULL);
+}
+
+void TileScene::setBatched(bool batched)
+{
+	_batched = batched;
+	foreach (Col *col, _cols)
+		col->setBatched(batched);
+}
+
+void TileScene::setVirtualized(bool virtualized)
+{
+	_virtualized = virtualized;
+	beginUpdate();
+	foreach (Col *col, _cols)
+		col->updateItems();
+	endUpdate();
+}
+
+/* Tiles that had items are within the old rect, so only the tiles in the
+ * old and new rects are looked at */
+void TileScene::setViewRect(const QRectF &rect)
+{
+	QRectF shown = rect.adjusted(0, -rect.height() / 2, 0, rect.height() / 2);
+	if (shown == _shownRect)
+		return;
+
+	QRectF old = _shownRect;
+	_shownRect = shown;
+	if (!_virtualized)
+		return;
+
+	foreach (Col *col, _cols) {
+		col->updateItems(old);
+		col->updateItems(shown);
+	}
+}
+
+void TileScene::setLowLatencyDrag(bool enabled)
+{
+	endDrag();
+	_lowLatencyDrag = enabled;
+}
+
+void TileScene::setTileCacheOff()
+{
+	Tile::setCacheLimit(0);
+}
+
+void TileScene::setTileCacheSmall()
+{
+	Tile::setCacheLimit(16 * 1024);
+}
+
+void TileScene::setTileCacheLarge()
+{
+	Tile::setCacheLimit(64 * 1024);
+}
+
 void TileScene::setPlacement(PlacementMode mode)
 {
+	Action action(this);
+	if (action.isRecorded())
+		action.record("placement " + QByteArray::number(mode));
 	if (mode != _placeMode) {
 		_placeMode = mode;
 		if (mode == NoCheck && _correctCount != _curRowCount)
@@ -19,11 +19,19 @@
 #ifndef TILESCENE_H
 #define TILESCENE_H
 
+#include "bank.h"
+#include "journal.h"
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QGraphicsScene>
+#include <QTimer>
+#include "recording.h"
+#include "reviews.h"
 
 class Col;
 class Row;
 class Tile;
+class TileItem;
 template<class T> class QList;
 
 class TileScene : public QGraphicsScene {
@@ -35,16 +43,115 @@ public:
 		NoCheck
 	};
 
+	/* Declared at the start of each slot that a user action can call, so
+	 * that the action is recorded. Calls made while handling another
+	 * action are not. An action with arguments is declared without a name
+	 * and passes its text to record() only if isRecorded(), so nothing is
+	 * formatted while no recording is made. */
+	class Action {
+	public:
+		Action(TileScene *scene, const char *name = NULL);
+		~Action();
+
+		inline bool isRecorded() const { return _recorded; }
+		void record(const QByteArray &action);
+
+	private:
+		TileScene *_scene;
+		bool _recorded;
+	};
+
 	TileScene(QObject *parent = NULL);
+	~TileScene();
 	void init();
 
+	/* The bank and each column draw from streams of their own, all made
+	 * from this seed. It starts out from the time. */
+	void setSeed(quint64 seed);
+	inline quint64 seed() const { return _seed; }
+
+	/* Recording starts with a new round; see Recording. */
+	bool startRecording(const QString &file, QString *error);
+	inline bool isRecording() const { return _recording.isRecording(); }
+	/* Plays a recording on a scene that has not been filled, without
+	 * waiting between actions. Returns the number of actions played, or -1
+	 * and sets error. */
+	int replay(const QString &file, QString *error);
+
 	void place();
 
+	/* Rows on the board in each round, from the next round on */
+	void setRoundSize(int rows);
+	/* Waits for the file that dump() is writing on the thread pool */
+	void waitForDump();
+
+	/* Changes made between beginUpdate() and endUpdate() skip the item
+	 * index and the views; the index is rebuilt and the scene repainted
+	 * once at the end. Calls nest. */
+	void beginUpdate();
+	void endUpdate();
+
+	inline Col *col(int i) const { return _cols.at(i); }
+	inline int colCount() const { return _colCount; }
+	inline int rowCount() const { return _curRowCount; }
+	inline int bankSize() const { return _bank.size(); }
+
+	/* All rows come from a pool, the entries of a round as well as the
+	 * rows checkRow() binds, so neither a round nor a drop allocates once
+	 * the pool is big enough. Tiles are kept by their columns the same way.
+	 * The allocation counts are the times the pools had to grow. Since a
+	 * pool never shrinks by itself, trimPools() cuts them down to what the
+	 * board needs when a deck is loaded or the board gets smaller. */
+	Row *takeRow();
+	void releaseRow(Row *row);
+	inline int rowAllocations() const { return _rowAllocations; }
+	int tileAllocations() const;
+
+	/* Tiles are records; the ones that are shown have an item from this
+	 * pool. See Col::updateItem(). */
+	void takeItem(Tile *tile);
+	void releaseItem(Tile *tile);
+	inline int itemAllocations() const { return _itemAllocations; }
+	inline int itemsInUse() const { return _itemsInUse; }
+
+	/* In virtualized mode, only the tiles within the view, or within half
+	 * its height above or below it, have items. The view tells us where it
+	 * is looking. */
+	inline bool isVirtualized() const { return _virtualized; }
+	inline QRectF shownRect() const { return _shownRect; }
+	void setViewRect(const QRectF &rect);
+
+	/* Called by the first column whenever its number of tiles changes */
+	void setRowCount(int);
+	/* Called by Row::checkRow() when a drop changes the row a tile is
+	 * bound to; row is NULL if it is no longer bound */
+	void onBind(Row *row);
+
+	/* Tiles are not QObjects, so these stand in for their signals. A
+	 * released tile is taken out of its column and row at once, and goes
+	 * back to its column's pool when control returns to the event loop. */
+	void dropTile(Tile *tile);
+	void releaseTile(Tile *tile);
+
+	/* The visible tile at pos, if any */
+	Tile *tileAt(const QPointF &pos) const;
+
+	/* With low-latency dragging, the view drags a tile by itself. The
+	 * tile leaves its column's bands and gives up its item until it is
+	 * dropped, so moving it changes nothing in the scene; the view draws
+	 * it over the scene meanwhile. False if the tile cannot be dragged
+	 * that way. dropTile() ends the drag. */
+	bool beginDrag(Tile *tile);
+	inline Tile *dragging() const { return _dragging; }
+
 	QString stateFile() const;
+	QString journalFile() const;
+	QString reviewsFile() const;
 
 signals:
 	void countChanged(int correct, int remaining);
 	void addRemoveGroup(Col*);
+	void loadProgress(int done, int total);
 
 public slots:
 	void addOne();
@@ -54,9 +161,13 @@ public slots:
 	void fill();
 	void fillState(bool error = true);
 	bool fill(const QString&, bool showError = true);
+	void fill(const QStringList&);
 	void dump();
 	void dumpState();
+	void finish();
 	void dump(const QString&);
+	void record();
+	void stopRecording();
 	void layout();
 	void reset();
 	void quitNow();
@@ -64,14 +175,57 @@ public slots:
 	void setPlacementAuto() { setPlacement(AutoCheck); }
 	void setPlacementManual() { setPlacement(ManualCheck); }
 	void setPlacementNo() { setPlacement(NoCheck); }
+	void setWeighted(bool);
+	void setScheduled(bool);
+	void setBatched(bool);
+	void setVirtualized(bool);
+	void setLowLatencyDrag(bool);
+	void setTileCacheOff();
+	void setTileCacheSmall();
+	void setTileCacheLarge();
+	void setDrawUniform() { setScheduled(false); setWeighted(false); }
+	void setDrawPerDeck() { setWeighted(true); }
+	void setDrawDue() { setScheduled(true); }
 
 protected slots:
-	void onBind(Row*);
-	void setRowCount(int);
+	void onLoadProgress(int);
+	void onLoaded();
+	void reapTiles();
+	void trimPools();
+	void onSaved();
+	void onExported();
+	void autosave();
 
 private:
+	struct Loaded {
+		Bank::DeckRef deck;
+		QString error;
+	};
+
+	static Loaded loadDeck(const QString &file);
+
+	struct Snapshot {
+		QString file;
+		/* Written with gzip: always for the state file, and for other
+		 * files whose names end in .gz */
+		bool compress;
+		Bank bank;
+		QList<Bank::Entry> rows;
+		/* Only saved with the state file */
+		QString reviewsFile;
+		Reviews reviews;
+	};
+
+	struct Saved {
+		QString file;
+		QString error;
+	};
+
+	Snapshot snapshot(const QString &file, bool shown) const;
+	static Saved save(const Snapshot &snapshot);
+	void waitForSave();
+
 	void add();
-	Tile *addTile(const QString &text, Col *group);
 	void removeTile(Tile *tile);
 	void setColCount(int);
 	void updateCounts();
@@ -79,15 +233,47 @@ private:
 	void reveal(bool show = true);
 	void stripCorrect();
 	void advance();
+	void clearBoard();
+	void discardBoard();
+	bool play(const QByteArray &action);
+	void endDrag();
+	void compact();
+	void checkCompact();
+	void journalError();
+	void completed(Tile *tile);
 
 	int _colCount;
 	int _rowCount;
 	int _curRowCount;
 	int _correctCount;
 	PlacementMode _placeMode;
+	bool _batched;
+	bool _virtualized;
+	QRectF _shownRect;
+	int _updateDepth;
+	ItemIndexMethod _indexMethod;
+	bool _lowLatencyDrag;
+	Tile *_dragging;
 
-	QList<QString> _bank;
+	Bank _bank;
+	Reviews _reviews;
+	Journal _journal;
+	QStringList _loading;
+	QElapsedTimer _loadTimer;
+	QFutureWatcher<Loaded> _loader;
+	QFutureWatcher<Saved> _saver;
+	QFutureWatcher<Saved> _exporter;
+	QTimer _autosave;
 	QList<Col*> _cols;
+	QList<Row*> _freeRows;
+	QList<Tile*> _deadTiles;
+	QList<TileItem*> _freeItems;
+	int _rowAllocations;
+	int _itemAllocations;
+	int _itemsInUse;
+	quint64 _seed;
+	Recording _recording;
+	int _actionDepth;
 };
 
 #endif
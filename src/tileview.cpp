@@ -16,31 +16,65 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "col.h"
+#include <QApplication>
+#include <QClipboard>
+#include <QPainter>
+#include <QStringList>
 #include <QWheelEvent>
+#include "tile.h"
 #include "tilescene.h"
 #include "tileview.h"
+#include "trace.h"
 
 TileView::TileView(TileScene *scene)
 	: QGraphicsView(scene)
 	, _scene(scene)
+	, _hud(false)
+	, _hudWidth(0)
+	, _input(-1)
+	, _lowLatencyDrag(false)
+	, _movePending(false)
 {
 	connect(_scene, SIGNAL(sceneRectChanged(const QRectF&)),
 	        this, SLOT(fit(const QRectF&)));
+	connect(&_hudTimer, SIGNAL(timeout()),
+	        this, SLOT(updateHud()));
 }
 
 void TileView::zoomIn()
 {
 	scale(1.2, 1.2);
+	updateViewRect();
 }
 
 void TileView::zoomOut()
 {
 	scale(0.8, 0.8);
+	updateViewRect();
 }
 
 void TileView::fit(const QRectF &rect)
 {
 	fitInView(rect, Qt::KeepAspectRatio);
+	updateViewRect();
+}
+
+void TileView::updateViewRect()
+{
+	_scene->setViewRect(mapToScene(viewport()->rect()).boundingRect());
+}
+
+void TileView::resizeEvent(QResizeEvent *ev)
+{
+	QGraphicsView::resizeEvent(ev);
+	updateViewRect();
+}
+
+void TileView::scrollContentsBy(int dx, int dy)
+{
+	QGraphicsView::scrollContentsBy(dx, dy);
+	updateViewRect();
 }
 
 void TileView::mouseDoubleClickEvent(QMouseEvent*)
@@ -72,3 +106,202 @@ void TileView::wheelEvent(QWheelEvent *ev)
 pass:
 	QGraphicsView::wheelEvent(ev);
 }
+
+void TileView::paintEvent(QPaintEvent *ev)
+{
+	{
+		Perf::Timer timer(Perf::Paint);
+		Trace::Span span("TileView::paint");
+		QGraphicsView::paintEvent(ev);
+	}
+
+	if (_input != -1) {
+		Perf::record(Perf::Counter(_input), _inputTimer.nsecsElapsed());
+		_input = -1;
+	}
+}
+
+/* A drop takes over a pending move, but keeps its start time */
+void TileView::noteInput(Perf::Counter counter)
+{
+	if (_input == -1)
+		_inputTimer.start();
+	if (_input != Perf::DropLatency)
+		_input = counter;
+}
+
+/*
+ * With low-latency dragging, the view drags tiles itself; see
+ * TileScene::beginDrag(). Moves are not handled as they come. Only the
+ * last of the moves that arrive together is, once the event loop gets to
+ * it, and only the parts of the viewport the tile leaves and enters are
+ * painted again.
+ */
+void TileView::mousePressEvent(QMouseEvent *ev)
+{
+	if (_lowLatencyDrag && ev->button() == Qt::LeftButton && !_scene->dragging()) {
+		QPointF pos = mapToScene(ev->pos());
+		Tile *tile = _scene->tileAt(pos);
+		if (tile && _scene->beginDrag(tile)) {
+			_grab = pos - tile->pos();
+			viewport()->update(mapFromScene(tile->rect()).boundingRect().adjusted(-1, -1, 1, 1));
+			ev->accept();
+			return;
+		}
+	}
+
+	QGraphicsView::mousePressEvent(ev);
+}
+
+void TileView::mouseMoveEvent(QMouseEvent *ev)
+{
+	if (!ev->buttons()) {
+		QGraphicsView::mouseMoveEvent(ev);
+		return;
+	}
+
+	noteInput(Perf::DragLatency);
+	if (!_scene->dragging()) {
+		QGraphicsView::mouseMoveEvent(ev);
+		return;
+	}
+
+	_movePos = ev->pos();
+	if (!_movePending) {
+		_movePending = true;
+		QMetaObject::invokeMethod(this, "flushMove", Qt::QueuedConnection);
+	}
+	ev->accept();
+}
+
+void TileView::flushMove()
+{
+	if (!_movePending)
+		return;
+
+	_movePending = false;
+	moveDragged(_movePos);
+}
+
+void TileView::moveDragged(const QPoint &pos)
+{
+	Tile *tile = _scene->dragging();
+	if (!tile)
+		return;
+
+	QRect from = mapFromScene(tile->rect()).boundingRect();
+	tile->setPos(mapToScene(pos) - _grab);
+	QRect to = mapFromScene(tile->rect()).boundingRect();
+	viewport()->update(from.adjusted(-1, -1, 1, 1));
+	viewport()->update(to.adjusted(-1, -1, 1, 1));
+}
+
+void TileView::mouseReleaseEvent(QMouseEvent *ev)
+{
+	flushMove();
+	noteInput(Perf::DropLatency);
+
+	Tile *tile = _scene->dragging();
+	if (tile && ev->button() == Qt::LeftButton) {
+		QRect rect = mapFromScene(tile->rect()).boundingRect();
+		_scene->dropTile(tile);
+		viewport()->update(rect.adjusted(-1, -1, 1, 1));
+		ev->accept();
+		return;
+	}
+
+	QGraphicsView::mouseReleaseEvent(ev);
+}
+
+/* Dirty regions are also left at the tiles' bounds, without the margin
+ * kept for antialiasing */
+void TileView::setLowLatencyDrag(bool enabled)
+{
+	flushMove();
+	_lowLatencyDrag = enabled;
+	setOptimizationFlag(QGraphicsView::DontAdjustForAntialiasing, enabled);
+	_scene->setLowLatencyDrag(enabled);
+}
+
+void TileView::setHudShown(bool shown)
+{
+	_hud = shown;
+	if (shown) {
+		_hudTimer.start(500);
+		updateHud();
+	} else {
+		_hudTimer.stop();
+		_hudLines.clear();
+		viewport()->update();
+	}
+}
+
+void TileView::updateHud()
+{
+	_hudLines = counters(false);
+	QFontMetrics metrics(font());
+	_hudWidth = 0;
+	foreach (const QString &line, _hudLines)
+		_hudWidth = qMax(_hudWidth, metrics.width(line));
+	viewport()->update();
+}
+
+void TileView::copyCounters()
+{
+	QApplication::clipboard()->setText(counters(true).join("\n") + '\n');
+}
+
+QStringList TileView::counters(bool csv) const
+{
+	QStringList lines;
+	if (csv)
+		lines.append("name,count,last_us,mean_us,max_us");
+
+	for (int i = 0; i != Perf::Counters; ++i) {
+		Perf::Counter counter = Perf::Counter(i);
+		const Perf::Stat &stat = Perf::stat(counter);
+		qreal mean = stat.count ? stat.total / 1000.0 / stat.count : 0;
+		if (csv)
+			lines.append(QString("%1,%2,%3,%4,%5").arg(Perf::name(counter)).arg(stat.count)
+				.arg(stat.last / 1000.0).arg(mean).arg(stat.max / 1000.0));
+		else
+			lines.append(QString("%1: %2x, last %3 ms, mean %4 ms, max %5 ms").arg(Perf::name(counter)).arg(stat.count)
+				.arg(stat.last / 1e6, 0, 'f', 2).arg(mean / 1000, 0, 'f', 2).arg(stat.max / 1e6, 0, 'f', 2));
+	}
+
+	int tiles = 0;
+	for (int i = 0; i != _scene->colCount(); ++i)
+		tiles += _scene->col(i)->tiles()->size();
+
+	const char *names[] = { "tiles", "tile items", "rows", "bank", "row allocations", "tile allocations", "item allocations" };
+	int values[] = { tiles, _scene->itemsInUse(), _scene->rowCount(), _scene->bankSize(),
+		_scene->rowAllocations(), _scene->tileAllocations(), _scene->itemAllocations() };
+	for (int i = 0; i != 7; ++i) {
+		if (csv)
+			lines.append(QString("%1,%2,,,").arg(names[i]).arg(values[i]));
+		else
+			lines.append(QString("%1: %2").arg(names[i]).arg(values[i]));
+	}
+
+	return lines;
+}
+
+/* The overlay is drawn in viewport coordinates, over the top left corner */
+void TileView::drawForeground(QPainter *painter, const QRectF&)
+{
+	if (Tile *tile = _scene->dragging())
+		tile->draw(painter, tile->pos());
+
+	if (!_hud)
+		return;
+
+	QFontMetrics metrics(font());
+	painter->save();
+	painter->resetTransform();
+	painter->setFont(font());
+	painter->fillRect(0, 0, _hudWidth + 8, _hudLines.size() * metrics.lineSpacing() + 8, QColor(255, 255, 255, 200));
+	painter->setPen(Qt::black);
+	for (int i = 0; i != _hudLines.size(); ++i)
+		painter->drawText(4, 4 + metrics.ascent() + i * metrics.lineSpacing(), _hudLines.at(i));
+	painter->restore();
+}
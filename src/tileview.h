@@ -19,7 +19,11 @@
 #ifndef TILEVIEW_H
 #define TILEVIEW_H
 
+#include "perf.h"
+#include <QElapsedTimer>
 #include <QGraphicsView>
+#include <QStringList>
+#include <QTimer>
 
 class TileScene;
 
@@ -32,13 +36,55 @@ public slots:
 	void zoomIn();
 	void zoomOut();
 	void fit(const QRectF&);
+	void setHudShown(bool);
+	void copyCounters();
+	void setLowLatencyDrag(bool);
 
 protected:
 	void mouseDoubleClickEvent(QMouseEvent*);
+	void mousePressEvent(QMouseEvent*);
+	void mouseMoveEvent(QMouseEvent*);
+	void mouseReleaseEvent(QMouseEvent*);
 	void wheelEvent(QWheelEvent*);
+	void paintEvent(QPaintEvent*);
+	void resizeEvent(QResizeEvent*);
+	void scrollContentsBy(int dx, int dy);
+	void drawForeground(QPainter*, const QRectF&);
+
+protected slots:
+	void flushMove();
+	void updateHud();
 
 private:
+	void noteInput(Perf::Counter counter);
+	/* Moves the tile the scene lets us drag, and repaints where it was
+	 * and where it is */
+	void moveDragged(const QPoint &pos);
+	/* Tells the scene what part of it we show */
+	void updateViewRect();
+
+	/* The timings from Perf, then the sizes of the round, for the overlay
+	 * and for copying */
+	QStringList counters(bool csv) const;
+
 	TileScene *_scene;
+	bool _hud;
+	QTimer _hudTimer;
+	/* The overlay's text, made on each tick of _hudTimer rather than on
+	 * each paint, so it does not add to the paint times it shows */
+	QStringList _hudLines;
+	int _hudWidth;
+
+	/* The oldest input not painted yet, for the latency counters */
+	int _input;
+	QElapsedTimer _inputTimer;
+
+	/* With low-latency dragging, the last mouse move not handled yet, and
+	 * where the tile being dragged was grabbed */
+	bool _lowLatencyDrag;
+	bool _movePending;
+	QPoint _movePos;
+	QPointF _grab;
 };
 
 #endif
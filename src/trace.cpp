@@ -0,0 +1,173 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QThreadStorage>
+#include <QVector>
+#include "trace.h"
+
+volatile bool Trace::_enabled = false;
+
+enum { RingSize = 16384 };
+
+struct Event {
+	const char *name;
+	qint64 start;
+	qint64 duration;
+};
+
+/*
+ * write() copies events without a lock while their thread may be writing
+ * over them. seq is the number of the event in the slot plus one, or 0
+ * while it is being written; reading it before and after the copy tells
+ * whether the copy is whole.
+ */
+struct Slot {
+	QAtomicInt seq;
+	Event event;
+};
+
+struct Ring {
+	int thread;
+	bool main;
+	/* Number of events ever recorded; the latest is at head - 1 */
+	QAtomicInt head;
+	Slot slots[RingSize];
+};
+
+/* The rings live as long as the program, so they can be saved after
+ * their thread is gone; QThreadStorage only frees the reference. */
+struct RingRef {
+	Ring *ring;
+};
+
+static QMutex ringsLock;
+static QList<Ring*> rings;
+static QThreadStorage<RingRef*> threadRing;
+
+static QElapsedTimer &traceClock()
+{
+	static QElapsedTimer timer;
+	if (!timer.isValid())
+		timer.start();
+	return timer;
+}
+
+void Trace::setEnabled(bool enabled)
+{
+	traceClock();
+	_enabled = enabled;
+}
+
+qint64 Trace::now()
+{
+	return traceClock().nsecsElapsed();
+}
+
+/* The lock is only taken the first time a thread records a span */
+static Ring *localRing()
+{
+	if (!threadRing.hasLocalData()) {
+		Ring *ring = new Ring;
+		ring->main = QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread();
+		RingRef *ref = new RingRef;
+		ref->ring = ring;
+
+		QMutexLocker locker(&ringsLock);
+		ring->thread = rings.size() + 1;
+		rings.append(ring);
+		threadRing.setLocalData(ref);
+	}
+
+	return threadRing.localData()->ring;
+}
+
+void Trace::record(const char *name, qint64 start)
+{
+	Ring *ring = localRing();
+	int head = ring->head;
+
+	Slot &slot = ring->slots[head % RingSize];
+	slot.seq.fetchAndStoreOrdered(0);
+	slot.event.name = name;
+	slot.event.start = start;
+	slot.event.duration = now() - start;
+
+	/* Publishes the event to write() */
+	slot.seq.fetchAndStoreRelease(head + 1);
+	ring->head.fetchAndStoreRelease(head + 1);
+}
+
+bool Trace::write(const QString &file, QString *error)
+{
+	QList<Ring*> all;
+	{
+		QMutexLocker locker(&ringsLock);
+		all = rings;
+	}
+
+	QByteArray out = "{\"traceEvents\":[\n";
+	bool first = true;
+
+	foreach (Ring *ring, all) {
+		/* Events that are overwritten before or while they are copied
+		 * are left out */
+		int head = ring->head.fetchAndAddAcquire(0);
+		int begin = qMax(0, head - RingSize);
+		QVector<Event> events;
+		events.reserve(head - begin);
+		for (int i = begin; i != head; ++i) {
+			Slot &slot = ring->slots[i % RingSize];
+			if (slot.seq.fetchAndAddAcquire(0) != i + 1)
+				continue;
+			Event event = slot.event;
+			if (slot.seq.fetchAndAddOrdered(0) == i + 1)
+				events.append(event);
+		}
+
+		QByteArray thread = QByteArray::number(ring->thread);
+		if (!first)
+			out += ",\n";
+		first = false;
+		out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + thread
+			+ ",\"args\":{\"name\":\"" + (ring->main ? QByteArray("GUI") : "thread " + thread) + "\"}}";
+
+		foreach (const Event &event, events) {
+			out += ",\n{\"name\":\"";
+			out += event.name;
+			out += "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + thread;
+			out += ",\"ts\":" + QByteArray::number(event.start / 1000.0, 'f', 3);
+			out += ",\"dur\":" + QByteArray::number(event.duration / 1000.0, 'f', 3) + '}';
+		}
+	}
+
+	out += "\n]}\n";
+
+	QFile store(file);
+	if (!store.open(QFile::WriteOnly) || store.write(out) != out.size()) {
+		*error = store.errorString();
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright © 2009 Christopher Eby <kreed@kreed.org>
+ *
+ * This file is part of Inquest.
+ *
+ * Inquest is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Inquest is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+
+/*
+ * Spans of time spent in the hot paths, saved in the Chrome trace format
+ * to be looked at on a timeline (chrome://tracing). Each thread records
+ * into a ring holding its last spans. Only that thread writes to it, so
+ * recording a span takes no lock. Nothing is recorded unless tracing is
+ * enabled.
+ */
+class Trace {
+public:
+	/* Records the scope it is declared in. name must be a literal. */
+	class Span {
+	public:
+		inline Span(const char *name) : _name(_enabled ? name : NULL) { if (_name) _start = now(); }
+		inline ~Span() { if (_name) record(_name, _start); }
+
+	private:
+		const char *_name;
+		qint64 _start;
+	};
+
+	static inline bool isEnabled() { return _enabled; }
+	static void setEnabled(bool enabled);
+	/* Writes the spans recorded so far */
+	static bool write(const QString &file, QString *error);
+
+private:
+	static qint64 now();
+	static void record(const char *name, qint64 start);
+
+	static volatile bool _enabled;
+};
+
+#endif